@@ -1,10 +1,23 @@
 // Single-player Tic-Tac-Toe with bot difficulties and win/loss counter
 
+#define _POSIX_C_SOURCE 200809L
+// sched_getaffinity and CPU_COUNT are GNU extensions
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 
-#define SIZE 3
+#define MAX_SIZE 7
+#define MAX_CELLS (MAX_SIZE * MAX_SIZE)
 
 typedef enum {
 	DIFF_EASY = 1,
@@ -12,21 +25,73 @@ typedef enum {
 	DIFF_HARD = 3
 } Difficulty;
 
-char board[SIZE][SIZE];
+int boardSize = 3;
+int winLength = 3;
+char board[MAX_SIZE][MAX_SIZE];
+
+// Every run of winLength cells along a row, column or diagonal, as cell
+// indexes (row * boardSize + col); shared by checkWinner and the evaluator
+#define MAX_WINDOWS (4 * MAX_CELLS)
+int windows[MAX_WINDOWS][MAX_SIZE];
+int windowCount = 0;
+
+// Cells sorted by distance from the center, for move ordering
+int moveOrder[MAX_CELLS];
+
+void setupBoardGeometry(int size, int win) {
+	int dr[4] = {0, 1, 1, 1};
+	int dc[4] = {1, 0, 1, -1};
+	boardSize = size;
+	winLength = win;
+	windowCount = 0;
+	for (int r = 0; r < size; r++) {
+		for (int c = 0; c < size; c++) {
+			for (int d = 0; d < 4; d++) {
+				int endR = r + dr[d] * (win - 1);
+				int endC = c + dc[d] * (win - 1);
+				if (endR < 0 || endR >= size || endC < 0 || endC >= size) continue;
+				for (int k = 0; k < win; k++) {
+					windows[windowCount][k] = (r + dr[d] * k) * size + (c + dc[d] * k);
+				}
+				windowCount++;
+			}
+		}
+	}
+	int cells = size * size;
+	int dist[MAX_CELLS];
+	for (int i = 0; i < cells; i++) {
+		int r2 = 2 * (i / size) - (size - 1);
+		int c2 = 2 * (i % size) - (size - 1);
+		dist[i] = r2 * r2 + c2 * c2;
+		moveOrder[i] = i;
+	}
+	// insertion sort keeps row-major order among equally central cells
+	for (int i = 1; i < cells; i++) {
+		int cell = moveOrder[i];
+		int j = i - 1;
+		while (j >= 0 && dist[moveOrder[j]] > dist[cell]) {
+			moveOrder[j + 1] = moveOrder[j];
+			j--;
+		}
+		moveOrder[j + 1] = cell;
+	}
+}
 
 void initializeBoard() {
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
+	for (int i = 0; i < boardSize; i++) {
+		for (int j = 0; j < boardSize; j++) {
 			board[i][j] = '-';
 		}
 	}
 }
 
 void printBoard() {
-	printf("  0 1 2\n");
-	for (int i = 0; i < SIZE; i++) {
+	printf(" ");
+	for (int j = 0; j < boardSize; j++) printf(" %d", j);
+	printf("\n");
+	for (int i = 0; i < boardSize; i++) {
 		printf("%d ", i);
-		for (int j = 0; j < SIZE; j++) {
+		for (int j = 0; j < boardSize; j++) {
 			printf("%c ", board[i][j]);
 		}
 		printf("\n");
@@ -34,31 +99,19 @@ void printBoard() {
 }
 
 char checkWinner() {
-	// rows
-	for (int i = 0; i < SIZE; i++) {
-		if (board[i][0] != '-' && board[i][0] == board[i][1] && board[i][1] == board[i][2]) {
-			return board[i][0];
-		}
-	}
-	// cols
-	for (int j = 0; j < SIZE; j++) {
-		if (board[0][j] != '-' && board[0][j] == board[1][j] && board[1][j] == board[2][j]) {
-			return board[0][j];
-		}
-	}
-	// diags
-	if (board[0][0] != '-' && board[0][0] == board[1][1] && board[1][1] == board[2][2]) {
-		return board[0][0];
-	}
-	if (board[0][2] != '-' && board[0][2] == board[1][1] && board[1][1] == board[2][0]) {
-		return board[0][2];
+	for (int w = 0; w < windowCount; w++) {
+		char first = board[windows[w][0] / boardSize][windows[w][0] % boardSize];
+		if (first == '-') continue;
+		int k = 1;
+		while (k < winLength && board[windows[w][k] / boardSize][windows[w][k] % boardSize] == first) k++;
+		if (k == winLength) return first;
 	}
 	return '-';
 }
 
 int isBoardFull() {
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
+	for (int i = 0; i < boardSize; i++) {
+		for (int j = 0; j < boardSize; j++) {
 			if (board[i][j] == '-') return 0;
 		}
 	}
@@ -73,7 +126,7 @@ int isGameOver() {
 }
 
 int isValidMove(int row, int col) {
-	return row >= 0 && row < SIZE && col >= 0 && col < SIZE && board[row][col] == '-';
+	return row >= 0 && row < boardSize && col >= 0 && col < boardSize && board[row][col] == '-';
 }
 
 void placeMark(int row, int col, char mark) {
@@ -85,8 +138,8 @@ void placeMark(int row, int col, char mark) {
 }
 
 int tryFindWinningMove(char mark, int *outRow, int *outCol) {
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
+	for (int i = 0; i < boardSize; i++) {
+		for (int j = 0; j < boardSize; j++) {
 			if (board[i][j] == '-') {
 				board[i][j] = mark;
 				if (checkWinner() == mark) {
@@ -102,10 +155,10 @@ int tryFindWinningMove(char mark, int *outRow, int *outCol) {
 }
 
 void botMoveEasy(char botMark) {
-	int empties[SIZE * SIZE][2];
+	int empties[MAX_CELLS][2];
 	int n = 0;
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
+	for (int i = 0; i < boardSize; i++) {
+		for (int j = 0; j < boardSize; j++) {
 			if (board[i][j] == '-') {
 				empties[n][0] = i;
 				empties[n][1] = j;
@@ -135,58 +188,530 @@ void botMoveMedium(char botMark, char humanMark) {
 	botMoveEasy(botMark);
 }
 
-int minimax(char currentMark, char botMark, char humanMark, int depth, int isMaximizing) {
-	char winner = checkWinner();
-	if (winner == botMark) return 10 - depth;
-	if (winner == humanMark) return depth - 10;
-	if (isBoardFull()) return 0;
+// ---------------- Hard bot: parallel game-tree search ----------------
+//
+// Depth-limited negamax with alpha-beta over a Position copy, so every worker
+// thread searches its own board. Nodes deep enough to be worth sharing are
+// split Young Brothers Wait style: the first (best-ordered) move is searched
+// alone to establish alpha, then the remaining moves become tasks on the
+// splitting worker's deque, where idle workers steal them. All threads share
+// one lock-free transposition table.
 
-	int bestScore = isMaximizing ? -1000 : 1000;
-	char player = isMaximizing ? botMark : humanMark;
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
-			if (board[i][j] == '-') {
-				board[i][j] = player;
-				int score = minimax(player, botMark, humanMark, depth + 1, !isMaximizing);
-				board[i][j] = '-';
-				if (isMaximizing) {
-					if (score > bestScore) bestScore = score;
-				} else {
-					if (score < bestScore) bestScore = score;
-				}
+#define WIN_SCORE 10000000
+#define INF_SCORE (WIN_SCORE + 1000)
+#define MATE_BOUND (WIN_SCORE - 1000)
+#define TT_BITS 20
+#define DEQUE_CAP 1024
+#define MIN_SPLIT_DEPTH 3
+#define MAX_THREADS 64
+
+typedef struct {
+	char cells[MAX_CELLS];
+	uint64_t hash;
+	int empties;
+} Position;
+
+uint64_t zobrist[MAX_CELLS][2];
+
+// Each entry stores (key ^ data, data). A reader that sees halves of two
+// different writes gets a mismatching key and treats it as a miss, so no
+// lock is needed.
+typedef struct {
+	_Atomic uint64_t check;
+	_Atomic uint64_t data;
+} TTEntry;
+
+enum { TT_EXACT = 0, TT_LOWER = 1, TT_UPPER = 2 };
+
+TTEntry *transpositionTable = NULL;
+uint64_t ttMask = 0;
+
+struct SplitPoint;
+
+typedef struct {
+	struct SplitPoint *sp;
+	int move;
+} Task;
+
+typedef struct SplitPoint {
+	struct SplitPoint *parent; // enclosing split, so a cutoff there stops this one too
+	Position pos;
+	char toMove;
+	int depth;
+	int ply;
+	int beta;
+	pthread_mutex_t lock;
+	_Atomic int alpha;
+	int bestScore;
+	int bestMove;
+	atomic_int cutoff;
+	atomic_int pending;
+} SplitPoint;
+
+typedef struct {
+	int id;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	Task deque[DEQUE_CAP];
+	int top;    // thieves take the oldest (largest) subtrees from here
+	int bottom; // the owner pushes and pops here
+	atomic_int queued; // bottom - top, readable without the lock
+	unsigned rng;
+	long nodes;
+} Worker;
+
+Worker workers[MAX_THREADS];
+int threadCount = 1;
+int searchDepth = 0; // 0 picks a depth from the board size
+atomic_int searchActive;
+atomic_int idleHelpers; // helpers asleep on poolWake, checked before waking any
+int poolQuit = 0;
+pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t poolWake = PTHREAD_COND_INITIALIZER;
+
+uint64_t splitMix64(uint64_t *state) {
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+int initSearch() {
+	uint64_t seed = 0x5EED;
+	for (int i = 0; i < MAX_CELLS; i++) {
+		zobrist[i][0] = splitMix64(&seed);
+		zobrist[i][1] = splitMix64(&seed);
+	}
+	size_t entries = (size_t)1 << TT_BITS;
+	transpositionTable = (TTEntry *)malloc(entries * sizeof(TTEntry));
+	if (!transpositionTable) return 0;
+	ttMask = entries - 1;
+	for (size_t i = 0; i < entries; i++) {
+		atomic_init(&transpositionTable[i].check, 0);
+		atomic_init(&transpositionTable[i].data, 0);
+	}
+	return 1;
+}
+
+void clearTranspositionTable() {
+	for (uint64_t i = 0; i <= ttMask; i++) {
+		atomic_store_explicit(&transpositionTable[i].check, 0, memory_order_relaxed);
+		atomic_store_explicit(&transpositionTable[i].data, 0, memory_order_relaxed);
+	}
+}
+
+// Win scores count down with distance from the root; the table stores them
+// relative to the node so they stay valid when reached at another ply
+int scoreToTable(int score, int ply) {
+	if (score > MATE_BOUND) return score + ply;
+	if (score < -MATE_BOUND) return score - ply;
+	return score;
+}
+
+int scoreFromTable(int score, int ply) {
+	if (score > MATE_BOUND) return score - ply;
+	if (score < -MATE_BOUND) return score + ply;
+	return score;
+}
+
+void ttStore(uint64_t key, int score, int depth, int flag, int move) {
+	uint64_t data = (uint64_t)(uint32_t)score | ((uint64_t)depth << 32) | ((uint64_t)flag << 40) | ((uint64_t)(move + 1) << 42);
+	TTEntry *e = &transpositionTable[key & ttMask];
+	atomic_store_explicit(&e->check, key ^ data, memory_order_relaxed);
+	atomic_store_explicit(&e->data, data, memory_order_relaxed);
+}
+
+int ttProbe(uint64_t key, int *score, int *depth, int *flag, int *move) {
+	TTEntry *e = &transpositionTable[key & ttMask];
+	uint64_t data = atomic_load_explicit(&e->data, memory_order_relaxed);
+	uint64_t check = atomic_load_explicit(&e->check, memory_order_relaxed);
+	if ((check ^ data) != key || data == 0) return 0;
+	*score = (int)(int32_t)(uint32_t)data;
+	*depth = (int)((data >> 32) & 0xff);
+	*flag = (int)((data >> 40) & 0x3);
+	*move = (int)((data >> 42) & 0xff) - 1;
+	return 1;
+}
+
+char opponentOf(char mark) {
+	return mark == 'X' ? 'O' : 'X';
+}
+
+Position positionFromBoard() {
+	Position pos;
+	memset(&pos, 0, sizeof(pos));
+	for (int i = 0; i < boardSize * boardSize; i++) {
+		char cell = board[i / boardSize][i % boardSize];
+		pos.cells[i] = cell;
+		if (cell == '-') pos.empties++;
+		else pos.hash ^= zobrist[i][cell == 'O'];
+	}
+	return pos;
+}
+
+void setCell(Position *pos, int cell, char mark) {
+	pos->cells[cell] = mark;
+	pos->hash ^= zobrist[cell][mark == 'O'];
+	pos->empties--;
+}
+
+void clearCell(Position *pos, int cell, char mark) {
+	pos->cells[cell] = '-';
+	pos->hash ^= zobrist[cell][mark == 'O'];
+	pos->empties++;
+}
+
+// Did placing mark at cell complete a line of winLength?
+int completesLine(const Position *pos, int cell, char mark) {
+	int dr[4] = {0, 1, 1, 1};
+	int dc[4] = {1, 0, 1, -1};
+	int row = cell / boardSize, col = cell % boardSize;
+	for (int d = 0; d < 4; d++) {
+		int count = 1;
+		for (int sign = -1; sign <= 1; sign += 2) {
+			int r = row + sign * dr[d], c = col + sign * dc[d];
+			while (r >= 0 && r < boardSize && c >= 0 && c < boardSize && pos->cells[r * boardSize + c] == mark) {
+				count++;
+				r += sign * dr[d];
+				c += sign * dc[d];
 			}
 		}
+		if (count >= winLength) return 1;
 	}
-	return bestScore;
+	return 0;
 }
 
-void botMoveHard(char botMark, char humanMark) {
-	int bestScore = -1000;
-	int bestR = -1, bestC = -1;
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
-			if (board[i][j] == '-') {
-				board[i][j] = botMark;
-				int score = minimax(botMark, botMark, humanMark, 0, 0);
-				board[i][j] = '-';
-				if (score > bestScore) {
-					bestScore = score;
-					bestR = i; bestC = j;
-				}
+// Heuristic for the side to move: windows still open to only one player,
+// weighted by how many of its cells that player already holds
+int evaluatePosition(const Position *pos, char toMove) {
+	int score = 0;
+	for (int w = 0; w < windowCount; w++) {
+		int mine = 0, theirs = 0;
+		for (int k = 0; k < winLength; k++) {
+			char cell = pos->cells[windows[w][k]];
+			if (cell == toMove) mine++;
+			else if (cell != '-') theirs++;
+		}
+		if (mine && !theirs) score += 1 << (2 * mine);
+		else if (theirs && !mine) score -= 1 << (2 * theirs);
+	}
+	return score;
+}
+
+int orderMoves(const Position *pos, int ttMove, int *moves) {
+	int n = 0;
+	if (ttMove >= 0 && ttMove < boardSize * boardSize && pos->cells[ttMove] == '-') moves[n++] = ttMove;
+	for (int i = 0; i < boardSize * boardSize; i++) {
+		int cell = moveOrder[i];
+		if (pos->cells[cell] == '-' && cell != ttMove) moves[n++] = cell;
+	}
+	return n;
+}
+
+int isAborted(const SplitPoint *sp) {
+	for (; sp; sp = sp->parent) {
+		if (atomic_load_explicit(&sp->cutoff, memory_order_relaxed)) return 1;
+	}
+	return 0;
+}
+
+int pushTask(Worker *w, Task task) {
+	pthread_mutex_lock(&w->lock);
+	if (w->bottom == DEQUE_CAP && w->top > 0) {
+		memmove(w->deque, w->deque + w->top, (size_t)(w->bottom - w->top) * sizeof(Task));
+		w->bottom -= w->top;
+		w->top = 0;
+	}
+	int ok = w->bottom < DEQUE_CAP;
+	if (ok) w->deque[w->bottom++] = task;
+	atomic_store_explicit(&w->queued, w->bottom - w->top, memory_order_relaxed);
+	pthread_mutex_unlock(&w->lock);
+	return ok;
+}
+
+int popTask(Worker *w, Task *out) {
+	pthread_mutex_lock(&w->lock);
+	int ok = w->bottom > w->top;
+	if (ok) *out = w->deque[--w->bottom];
+	if (w->bottom == w->top) w->bottom = w->top = 0;
+	atomic_store_explicit(&w->queued, w->bottom - w->top, memory_order_relaxed);
+	pthread_mutex_unlock(&w->lock);
+	return ok;
+}
+
+int stealTask(Worker *thief, Task *out) {
+	int start = (int)(rand_r(&thief->rng) % (unsigned)threadCount);
+	for (int k = 0; k < threadCount; k++) {
+		Worker *victim = &workers[(start + k) % threadCount];
+		if (victim == thief || atomic_load_explicit(&victim->queued, memory_order_relaxed) == 0) continue;
+		pthread_mutex_lock(&victim->lock);
+		int ok = victim->bottom > victim->top;
+		if (ok) *out = victim->deque[victim->top++];
+		if (victim->bottom == victim->top) victim->bottom = victim->top = 0;
+		atomic_store_explicit(&victim->queued, victim->bottom - victim->top, memory_order_relaxed);
+		pthread_mutex_unlock(&victim->lock);
+		if (ok) return 1;
+	}
+	return 0;
+}
+
+int anyTaskQueued() {
+	for (int i = 0; i < threadCount; i++) {
+		if (atomic_load(&workers[i].queued) > 0) return 1;
+	}
+	return 0;
+}
+
+// Called after pushing tasks. The fence pairs with the one in helperMain:
+// either we see the helper counted as idle, or it sees our tasks queued.
+void wakeIdleHelpers() {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&idleHelpers) == 0) return;
+	pthread_mutex_lock(&poolLock);
+	pthread_cond_broadcast(&poolWake);
+	pthread_mutex_unlock(&poolLock);
+}
+
+int search(Worker *w, Position *pos, int depth, int alpha, int beta, int ply, char toMove, SplitPoint *parent, int *outMove);
+
+// Plays cell for mover, scores it from mover's point of view, and undoes it
+int scoreMove(Worker *w, Position *pos, int cell, char mover, int depth, int alpha, int beta, int ply, SplitPoint *parent) {
+	setCell(pos, cell, mover);
+	int score;
+	if (completesLine(pos, cell, mover)) score = WIN_SCORE - (ply + 1);
+	else if (pos->empties == 0) score = 0;
+	else score = -search(w, pos, depth - 1, -beta, -alpha, ply + 1, opponentOf(mover), parent, NULL);
+	clearCell(pos, cell, mover);
+	return score;
+}
+
+void runTask(Worker *w, Task *task) {
+	SplitPoint *sp = task->sp;
+	int alpha = atomic_load_explicit(&sp->alpha, memory_order_relaxed);
+	if (!isAborted(sp) && alpha < sp->beta) {
+		Position child = sp->pos; // this worker's own copy
+		int score = scoreMove(w, &child, task->move, sp->toMove, sp->depth, alpha, sp->beta, sp->ply, sp);
+		if (!isAborted(sp)) {
+			pthread_mutex_lock(&sp->lock);
+			if (score > sp->bestScore) {
+				sp->bestScore = score;
+				sp->bestMove = task->move;
 			}
+			if (score > atomic_load_explicit(&sp->alpha, memory_order_relaxed)) atomic_store(&sp->alpha, score);
+			if (score >= sp->beta) atomic_store(&sp->cutoff, 1);
+			pthread_mutex_unlock(&sp->lock);
+		}
+	}
+	// Last touch: the split point lives on its owner's stack
+	atomic_fetch_sub_explicit(&sp->pending, 1, memory_order_release);
+}
+
+// The owner of a split point keeps working (its own tasks first, then
+// stolen ones) until every task of the split point has finished
+void helpUntilDone(Worker *w, SplitPoint *sp) {
+	while (atomic_load_explicit(&sp->pending, memory_order_acquire) > 0) {
+		Task task;
+		if (popTask(w, &task) || stealTask(w, &task)) runTask(w, &task);
+		else sched_yield();
+	}
+}
+
+int search(Worker *w, Position *pos, int depth, int alpha, int beta, int ply, char toMove, SplitPoint *parent, int *outMove) {
+	w->nodes++;
+	if (isAborted(parent)) return 0;
+	int alphaOrig = alpha;
+	int ttScore, ttDepth, ttFlag, ttMove = -1;
+	if (ttProbe(pos->hash, &ttScore, &ttDepth, &ttFlag, &ttMove) && ttDepth >= depth && !outMove) {
+		ttScore = scoreFromTable(ttScore, ply);
+		if (ttFlag == TT_EXACT) return ttScore;
+		if (ttFlag == TT_LOWER && ttScore >= beta) return ttScore;
+		if (ttFlag == TT_UPPER && ttScore <= alpha) return ttScore;
+	}
+	if (depth <= 0) return evaluatePosition(pos, toMove);
+
+	int moves[MAX_CELLS];
+	int n = orderMoves(pos, ttMove, moves);
+	// Eldest brother first, alone
+	int best = scoreMove(w, pos, moves[0], toMove, depth, alpha, beta, ply, parent);
+	int bestMove = moves[0];
+	if (best > alpha) alpha = best;
+	int next = 1;
+	if (alpha < beta && n > 1 && threadCount > 1 && depth >= MIN_SPLIT_DEPTH) {
+		SplitPoint sp;
+		sp.parent = parent;
+		sp.pos = *pos;
+		sp.toMove = toMove;
+		sp.depth = depth;
+		sp.ply = ply;
+		sp.beta = beta;
+		pthread_mutex_init(&sp.lock, NULL);
+		atomic_init(&sp.alpha, alpha);
+		sp.bestScore = best;
+		sp.bestMove = bestMove;
+		atomic_init(&sp.cutoff, 0);
+		atomic_init(&sp.pending, n - 1);
+		// Pushed worst-first so the owner pops the better-ordered moves first
+		for (int i = n - 1; i >= 1; i--) {
+			Task task = {&sp, moves[i]};
+			if (!pushTask(w, task)) runTask(w, &task);
+		}
+		wakeIdleHelpers();
+		helpUntilDone(w, &sp);
+		best = sp.bestScore;
+		bestMove = sp.bestMove;
+		alpha = atomic_load(&sp.alpha);
+		pthread_mutex_destroy(&sp.lock);
+		next = n;
+	}
+	for (int i = next; i < n && alpha < beta; i++) {
+		int score = scoreMove(w, pos, moves[i], toMove, depth, alpha, beta, ply, parent);
+		if (score > best) {
+			best = score;
+			bestMove = moves[i];
 		}
+		if (score > alpha) alpha = score;
 	}
-	if (bestR != -1) {
-		board[bestR][bestC] = botMark;
+	// A cutoff above us means these scores were cut short; do not keep them
+	if (isAborted(parent)) return 0;
+	int flag = best <= alphaOrig ? TT_UPPER : (best >= beta ? TT_LOWER : TT_EXACT);
+	ttStore(pos->hash, scoreToTable(best, ply), depth, flag, bestMove);
+	if (outMove) *outMove = bestMove;
+	return best;
+}
+
+// Helpers steal while there is work and otherwise sleep on poolWake, both
+// between searches and between split points within one
+void *helperMain(void *arg) {
+	Worker *w = (Worker *)arg;
+	Task task;
+	while (1) {
+		if (atomic_load(&searchActive) && stealTask(w, &task)) {
+			runTask(w, &task);
+			continue;
+		}
+		pthread_mutex_lock(&poolLock);
+		atomic_fetch_add(&idleHelpers, 1);
+		atomic_thread_fence(memory_order_seq_cst);
+		while (!poolQuit && !(atomic_load(&searchActive) && anyTaskQueued())) pthread_cond_wait(&poolWake, &poolLock);
+		atomic_fetch_sub(&idleHelpers, 1);
+		int quit = poolQuit;
+		pthread_mutex_unlock(&poolLock);
+		if (quit) return NULL;
+	}
+}
+
+// Worker 0 is the calling thread; the others sleep between searches
+void startWorkers(int count) {
+	if (count < 1) count = 1;
+	if (count > MAX_THREADS) count = MAX_THREADS;
+	threadCount = count;
+	poolQuit = 0;
+	atomic_store(&searchActive, 0);
+	atomic_store(&idleHelpers, 0);
+	for (int i = 0; i < count; i++) {
+		workers[i].id = i;
+		workers[i].top = workers[i].bottom = 0;
+		atomic_init(&workers[i].queued, 0);
+		workers[i].rng = 0x9E3779B9u * (unsigned)(i + 1);
+		workers[i].nodes = 0;
+		pthread_mutex_init(&workers[i].lock, NULL);
+	}
+	for (int i = 1; i < count; i++) {
+		if (pthread_create(&workers[i].thread, NULL, helperMain, &workers[i]) != 0) {
+			threadCount = i;
+			break;
+		}
+	}
+}
+
+void stopWorkers() {
+	pthread_mutex_lock(&poolLock);
+	poolQuit = 1;
+	pthread_cond_broadcast(&poolWake);
+	pthread_mutex_unlock(&poolLock);
+	for (int i = 1; i < threadCount; i++) pthread_join(workers[i].thread, NULL);
+	for (int i = 0; i < threadCount; i++) pthread_mutex_destroy(&workers[i].lock);
+}
+
+// Exact search while the remaining game is small, shallower on big boards
+int defaultSearchDepth(int empties) {
+	if (empties <= 10) return empties;
+	if (boardSize <= 5) return 8;
+	return 6;
+}
+
+// Iterative deepening to maxDepth; returns the chosen cell or -1
+int findBestMove(char botMark, int maxDepth, long *nodesOut) {
+	Position root = positionFromBoard();
+	if (root.empties == 0) return -1;
+	if (maxDepth > root.empties) maxDepth = root.empties;
+	for (int i = 0; i < threadCount; i++) workers[i].nodes = 0;
+	pthread_mutex_lock(&poolLock);
+	atomic_store(&searchActive, 1);
+	pthread_cond_broadcast(&poolWake);
+	pthread_mutex_unlock(&poolLock);
+	int bestMove = -1;
+	for (int depth = 1; depth <= maxDepth; depth++) {
+		int move = -1;
+		search(&workers[0], &root, depth, -INF_SCORE, INF_SCORE, 0, botMark, NULL, &move);
+		if (move >= 0) bestMove = move;
+	}
+	atomic_store(&searchActive, 0);
+	if (nodesOut) {
+		*nodesOut = 0;
+		for (int i = 0; i < threadCount; i++) *nodesOut += workers[i].nodes;
+	}
+	return bestMove;
+}
+
+void botMoveHard(char botMark) {
+	Position pos = positionFromBoard();
+	int depth = searchDepth > 0 ? searchDepth : defaultSearchDepth(pos.empties);
+	int move = findBestMove(botMark, depth, NULL);
+	if (move >= 0) {
+		board[move / boardSize][move % boardSize] = botMark;
 	} else {
 		botMoveEasy(botMark);
 	}
 }
 
+// CPUs this process may run on: the affinity mask on Linux (taskset and
+// container cpusets narrow it), else the online count
+int availableCpus() {
+#if defined(__linux__) && defined(CPU_COUNT)
+	cpu_set_t set;
+	if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0) return CPU_COUNT(&set);
+#endif
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? (int)cpus : 1;
+}
+
+// Fixed-depth search of the empty board at 1, 2, 4, ... threads
+void runBench(int maxThreads, int depth) {
+	initializeBoard();
+	if (depth <= 0) depth = defaultSearchDepth(boardSize * boardSize);
+	printf("Search bench: %dx%d board, %d in a row, depth %d (CPUs available: %d)\n", boardSize, boardSize, winLength, depth, availableCpus());
+	double baseMs = 0.0;
+	for (int t = 1; t <= maxThreads; t = (t * 2 > maxThreads && t < maxThreads) ? maxThreads : t * 2) {
+		startWorkers(t);
+		clearTranspositionTable();
+		struct timespec start, end;
+		long nodes = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		int move = findBestMove('X', depth, &nodes);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		stopWorkers();
+		double ms = (double)(end.tv_sec - start.tv_sec) * 1000.0 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+		if (t == 1) baseMs = ms;
+		printf("  threads %2d: %9.1f ms  %10ld nodes  speedup %.2fx  move %d,%d\n",
+			t, ms, nodes, ms > 0.0 ? baseMs / ms : 0.0, move / boardSize, move % boardSize);
+	}
+}
+
 void botMove(Difficulty diff, char botMark, char humanMark) {
 	if (diff == DIFF_EASY) botMoveEasy(botMark);
 	else if (diff == DIFF_MEDIUM) botMoveMedium(botMark, humanMark);
-	else botMoveHard(botMark, humanMark);
+	else botMoveHard(botMark);
 }
 
 int readIntInRange(const char *prompt, int minVal, int maxVal) {
@@ -215,11 +740,11 @@ char readYesNo(const char *prompt) {
 
 void readMove(int *outRow, int *outCol) {
 	while (1) {
-		printf("Enter move as 'row col' (0-2 0-2): ");
+		printf("Enter move as 'row col' (0-%d 0-%d): ", boardSize - 1, boardSize - 1);
 		int r, c;
 		int count = scanf("%d %d", &r, &c);
 		if (count == 2) {
-			if (r >= 0 && r < SIZE && c >= 0 && c < SIZE) {
+			if (r >= 0 && r < boardSize && c >= 0 && c < boardSize) {
 				if (isValidMove(r, c)) {
 					*outRow = r;
 					*outCol = c;
@@ -237,12 +762,58 @@ void readMove(int *outRow, int *outCol) {
 	}
 }
 
-int main() {
+int main(int argc, char **argv) {
 	srand((unsigned int)time(NULL));
 
+	int cpus = availableCpus();
+	int threads = cpus;
+	int bench = 0, benchSize = 5, benchWin = 4;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) searchDepth = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bench") == 0) bench = 1;
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) benchSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--win") == 0 && i + 1 < argc) benchWin = atoi(argv[++i]);
+		else {
+			printf("Usage: %s [--threads N] [--depth N] [--bench [--size N] [--win K]]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (threads < 1) threads = 1;
+	if (threads > MAX_THREADS) threads = MAX_THREADS;
+	if (!initSearch()) {
+		printf("Out of memory.\n");
+		return 1;
+	}
+
+	if (bench) {
+		if (benchSize < 3 || benchSize > MAX_SIZE) benchSize = 5;
+		if (benchWin < 3 || benchWin > benchSize) benchWin = benchSize;
+		setupBoardGeometry(benchSize, benchWin);
+		runBench(threads, searchDepth);
+		free(transpositionTable);
+		return 0;
+	}
+
+	// More search threads than CPUs only adds overhead, so the game never
+	// uses them; --bench still runs past the CPU count to show the cost
+	if (threads > cpus) {
+		printf("Using %d search thread%s, one per available CPU.\n", cpus, cpus == 1 ? "" : "s");
+		threads = cpus;
+	}
+	startWorkers(threads);
 	int wins = 0, losses = 0, draws = 0;
 	printf("Tic Tac Toe (You vs Bot)\n");
 	while (1) {
+		int size = readIntInRange("Board size (3-7): ", 3, MAX_SIZE);
+		int win = 3;
+		if (size > 3) {
+			char prompt[64];
+			snprintf(prompt, sizeof(prompt), "Marks in a row to win (3-%d): ", size);
+			win = readIntInRange(prompt, 3, size);
+		}
+		setupBoardGeometry(size, win);
+		clearTranspositionTable();
 		initializeBoard();
 
 		printf("Select difficulty: 1) Easy  2) Medium  3) Hard\n");
@@ -298,5 +869,7 @@ int main() {
 		}
 	}
 
+	stopWorkers();
+	free(transpositionTable);
 	return 0;
 }
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Builds datePicker and mockUpstream, starts the mock, and benchmarks datePicker against it.
+# Usage: ./bench.sh [iterations] [extra datePicker flags...]
+# Mock behaviour is tunable via MOCK_FLAGS, e.g. MOCK_FLAGS="--latency-ms 40 --jitter-ms 20 --error-rate 0.02"
+set -e
+cd "$(dirname "$0")"
+
+ITERATIONS=${1:-200}
+[ $# -gt 0 ] && shift
+PORT=${MOCK_PORT:-9000}
+
+gcc -std=c11 -Wall -Wextra -O2 datePicker.c -o datePicker_app -lcurl -pthread
+gcc -std=c11 -Wall -Wextra -O2 mockUpstream.c -o mockUpstream -pthread
+
+./mockUpstream --port "$PORT" $MOCK_FLAGS >/dev/null &
+MOCK_PID=$!
+trap 'kill $MOCK_PID 2>/dev/null' EXIT INT TERM
+sleep 0.3
+
+OPENWEATHER_BASE_URL="http://127.0.0.1:$PORT" \
+TICKETMASTER_BASE_URL="http://127.0.0.1:$PORT" \
+./datePicker_app --bench "$ITERATIONS" "$@"
+
+echo "Mock upstream counters: $(curl -s "http://127.0.0.1:$PORT/__stats")"
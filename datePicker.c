@@ -1,8 +1,28 @@
+#define _POSIX_C_SOURCE 200809L
+/* Strict POSIX mode hides SO_NOSIGPIPE on macOS */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
 #include <time.h>
 #include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 #include <curl/curl.h>
 
 typedef enum {
@@ -131,11 +151,24 @@ typedef struct {
 	double weight;
 } MonthCandidate;
 
+/* rand() keeps one hidden state for the whole process; service workers draw
+ * concurrently, so every thread keeps its own rand_r() state instead */
+static _Thread_local unsigned int random_state;
+static _Thread_local int random_seeded;
+
+static int random_next(void) {
+	if (!random_seeded) {
+		random_state = (unsigned int)time(NULL) ^ (unsigned int)(uintptr_t)&random_state;
+		random_seeded = 1;
+	}
+	return rand_r(&random_state);
+}
+
 static int pick_weighted_index(const double *weights, int n) {
 	double total = 0.0;
 	for (int i = 0; i < n; ++i) total += (weights[i] > 0.0 ? weights[i] : 0.0);
-	if (total <= 0.0) return rand() % n;
-	double r = ((double)rand() / (double)RAND_MAX) * total;
+	if (total <= 0.0) return random_next() % n;
+	double r = ((double)random_next() / (double)RAND_MAX) * total;
 	double acc = 0.0;
 	for (int i = 0; i < n; ++i) {
 		acc += (weights[i] > 0.0 ? weights[i] : 0.0);
@@ -144,20 +177,22 @@ static int pick_weighted_index(const double *weights, int n) {
 	return n - 1;
 }
 
-static void pick_date(Hemisphere hemi, WeatherType weather, int *out_year, int *out_month, int *out_day) {
+/* month_weights, when given, holds the city's observed frequency of weather
+ * for January..December and replaces the seasonal heuristic */
+static void pick_date(Hemisphere hemi, WeatherType weather, const double *month_weights, int *out_year, int *out_month, int *out_day) {
 	/* Build the next 12 months window starting this month */
 	time_t now = time(NULL);
-	struct tm *lt = localtime(&now);
-	int cur_year = lt->tm_year + 1900;
-	int cur_month = lt->tm_mon + 1; /* 1-12 */
+	struct tm lt;
+	localtime_r(&now, &lt);
+	int cur_year = lt.tm_year + 1900;
+	int cur_month = lt.tm_mon + 1; /* 1-12 */
 
 	MonthCandidate candidates[12];
 	double weights[12];
 	for (int i = 0; i < 12; ++i) {
 		int m = ((cur_month - 1 + i) % 12) + 1;
 		int y = cur_year + ((cur_month - 1 + i) / 12);
-		Season season = month_to_season(m, hemi);
-		double w = season_affinity(weather, season);
+		double w = month_weights ? month_weights[m - 1] : season_affinity(weather, month_to_season(m, hemi));
 		/* Slightly boost nearer months so we respect "time of year it is" */
 		double recency = 1.0 - (i * 0.03); /* decays across the year */
 		if (recency < 0.7) recency = 0.7;
@@ -171,7 +206,7 @@ static void pick_date(Hemisphere hemi, WeatherType weather, int *out_year, int *
 	int year = candidates[idx].year;
 	int month = candidates[idx].month;
 	int dim = days_in_month(year, month);
-	int day = (rand() % dim) + 1;
+	int day = (random_next() % dim) + 1;
 
 	*out_year = year;
 	*out_month = month;
@@ -183,51 +218,909 @@ typedef struct {
 	size_t size;
 } MemoryBuffer;
 
-static size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-	size_t realsize = size * nmemb;
-	MemoryBuffer *mem = (MemoryBuffer *)userp;
-	char *ptr = (char*)realloc(mem->data, mem->size + realsize + 1);
+static int buffer_append(MemoryBuffer *mem, const char *src, size_t len) {
+	char *ptr = (char*)realloc(mem->data, mem->size + len + 1);
 	if (!ptr) return 0;
 	mem->data = ptr;
-	memcpy(&(mem->data[mem->size]), contents, realsize);
-	mem->size += realsize;
+	memcpy(&(mem->data[mem->size]), src, len);
+	mem->size += len;
 	mem->data[mem->size] = '\0';
+	return 1;
+}
+
+static int buffer_appendf(MemoryBuffer *mem, const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	if (n < 0) return 0;
+	char stackbuf[256];
+	char *tmp = (n < (int)sizeof(stackbuf)) ? stackbuf : (char*)malloc((size_t)n + 1);
+	if (!tmp) return 0;
+	va_start(ap, fmt);
+	vsnprintf(tmp, (size_t)n + 1, fmt, ap);
+	va_end(ap);
+	int ok = buffer_append(mem, tmp, (size_t)n);
+	if (tmp != stackbuf) free(tmp);
+	return ok;
+}
+
+static size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+	size_t realsize = size * nmemb;
+	MemoryBuffer *mem = (MemoryBuffer *)userp;
+	if (!buffer_append(mem, (const char *)contents, realsize)) return 0;
 	return realsize;
 }
 
-static int fetch_openweather_json(const char *city, const char *api_key, char **out_json) {
-	if (!city || !api_key || !out_json) return 0;
-	CURL *curl = curl_easy_init();
-	if (!curl) return 0;
-	char *city_enc = curl_easy_escape(curl, city, 0);
-	if (!city_enc) { curl_easy_cleanup(curl); return 0; }
-	char url[512];
-	snprintf(url, sizeof(url), "https://api.openweathermap.org/data/2.5/weather?q=%s&appid=%s", city_enc, api_key);
-	curl_free(city_enc);
+/* ---------------- Response Cache ---------------- */
 
-	int attempts = 0;
-	while (attempts < 3) {
-		attempts++;
+/* Direct-mapped response cache keyed by request URL. A colliding key simply
+ * replaces the previous occupant; entries older than ttl_seconds are misses. */
+#define CACHE_SLOTS 256
+
+typedef struct {
+	char *key;
+	char *body;
+	time_t stored_at;
+	int prefetched; /* stored by a prefetch and not yet read by a call */
+} CacheEntry;
+
+typedef struct {
+	CacheEntry slots[CACHE_SLOTS];
+	int ttl_seconds;
+	pthread_mutex_t lock;
+} ResponseCache;
+
+static uint64_t hash_string(const char *s) {
+	/* FNV-1a */
+	uint64_t h = 1469598103934665603ULL;
+	for (; *s; ++s) {
+		h ^= (unsigned char)*s;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static void cache_init(ResponseCache *cache, int ttl_seconds) {
+	memset(cache->slots, 0, sizeof(cache->slots));
+	cache->ttl_seconds = ttl_seconds;
+	pthread_mutex_init(&cache->lock, NULL);
+}
+
+static void cache_clear(ResponseCache *cache) {
+	pthread_mutex_lock(&cache->lock);
+	for (int i = 0; i < CACHE_SLOTS; ++i) {
+		free(cache->slots[i].key);
+		free(cache->slots[i].body);
+	}
+	memset(cache->slots, 0, sizeof(cache->slots));
+	pthread_mutex_unlock(&cache->lock);
+}
+
+static void cache_destroy(ResponseCache *cache) {
+	cache_clear(cache);
+	pthread_mutex_destroy(&cache->lock);
+}
+
+/* Returns a heap copy of the cached body (caller frees) or NULL on miss.
+ * When prefetched is non-NULL it reports, and clears, the entry's prefetch
+ * mark so only the first read of a prefetched body counts as a prefetch hit */
+static char *cache_get(ResponseCache *cache, const char *key, int *prefetched) {
+	if (prefetched) *prefetched = 0;
+	if (cache->ttl_seconds <= 0) return NULL;
+	char *copy = NULL;
+	CacheEntry *e = &cache->slots[hash_string(key) % CACHE_SLOTS];
+	pthread_mutex_lock(&cache->lock);
+	if (e->key && strcmp(e->key, key) == 0 && time(NULL) - e->stored_at < cache->ttl_seconds) {
+		copy = strdup(e->body);
+		if (copy && prefetched) {
+			*prefetched = e->prefetched;
+			e->prefetched = 0;
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+	return copy;
+}
+
+static void cache_put(ResponseCache *cache, const char *key, const char *body, int prefetched) {
+	if (cache->ttl_seconds <= 0) return;
+	char *k = strdup(key);
+	char *b = strdup(body);
+	if (!k || !b) { free(k); free(b); return; }
+	CacheEntry *e = &cache->slots[hash_string(key) % CACHE_SLOTS];
+	pthread_mutex_lock(&cache->lock);
+	free(e->key);
+	free(e->body);
+	e->key = k;
+	e->body = b;
+	e->stored_at = time(NULL);
+	e->prefetched = prefetched;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/* ---------------- Retry Policy, Deadlines and Circuit Breaking ---------------- */
+
+static long long monotonic_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000L;
+}
+
+/* Fractional milliseconds; monotonic_ms is too coarse for sub-ms timings */
+static double precise_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static void sleep_ms(long ms) {
+	if (ms <= 0) return;
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+/* Overall time budget shared by every upstream call made for one request */
+#define REQUEST_BUDGET_MS 15000
+
+typedef struct {
+	long long expires_at_ms;
+} Deadline;
+
+static Deadline deadline_in(long budget_ms) {
+	Deadline d;
+	d.expires_at_ms = monotonic_ms() + budget_ms;
+	return d;
+}
+
+static long deadline_remaining_ms(const Deadline *d) {
+	long long left = d->expires_at_ms - monotonic_ms();
+	return left > 0 ? (long)left : 0;
+}
+
+typedef struct {
+	int max_attempts;
+	long attempt_timeout_ms;
+	long connect_timeout_ms;
+	long base_backoff_ms;
+	long max_backoff_ms;
+} RetryPolicy;
+
+static const RetryPolicy default_retry_policy = {
+	4,     /* max_attempts */
+	4000,  /* attempt_timeout_ms */
+	2000,  /* connect_timeout_ms */
+	100,   /* base_backoff_ms */
+	2000   /* max_backoff_ms */
+};
+
+typedef enum {
+	BREAKER_CLOSED = 0,
+	BREAKER_OPEN,
+	BREAKER_HALF_OPEN
+} BreakerState;
+
+/* Opens after failure_threshold consecutive upstream failures and rejects
+ * calls until cooldown_ms has passed; then a single probe decides whether
+ * it closes again or re-opens. */
+typedef struct {
+	pthread_mutex_t lock;
+	BreakerState state;
+	int consecutive_failures;
+	int failure_threshold;
+	long cooldown_ms;
+	long long opened_at_ms;
+	int probe_in_flight;
+} CircuitBreaker;
+
+static void breaker_init(CircuitBreaker *b, int failure_threshold, long cooldown_ms) {
+	pthread_mutex_init(&b->lock, NULL);
+	b->state = BREAKER_CLOSED;
+	b->consecutive_failures = 0;
+	b->failure_threshold = failure_threshold;
+	b->cooldown_ms = cooldown_ms;
+	b->opened_at_ms = 0;
+	b->probe_in_flight = 0;
+}
+
+/* Returns 0 to reject, 1 to allow, or 2 when the caller took the half-open
+ * probe and must settle it with breaker_record or breaker_release */
+static int breaker_allow(CircuitBreaker *b) {
+	int allowed = 1;
+	pthread_mutex_lock(&b->lock);
+	if (b->state == BREAKER_OPEN) {
+		if (monotonic_ms() - b->opened_at_ms >= b->cooldown_ms) {
+			b->state = BREAKER_HALF_OPEN;
+			b->probe_in_flight = 1;
+			allowed = 2;
+		} else {
+			allowed = 0;
+		}
+	} else if (b->state == BREAKER_HALF_OPEN) {
+		/* Only one probe at a time while half-open */
+		if (b->probe_in_flight) allowed = 0;
+		else {
+			b->probe_in_flight = 1;
+			allowed = 2;
+		}
+	}
+	pthread_mutex_unlock(&b->lock);
+	return allowed;
+}
+
+/* Gives back a probe that ended without telling us anything about the
+ * upstream (cancelled, or never sent) so the next call can probe instead */
+static void breaker_release(CircuitBreaker *b) {
+	pthread_mutex_lock(&b->lock);
+	if (b->state == BREAKER_HALF_OPEN) b->probe_in_flight = 0;
+	pthread_mutex_unlock(&b->lock);
+}
+
+/* probe says whether this call held the half-open probe. Other calls that
+ * started before the breaker opened may finish later. They say nothing
+ * about recovery, so they cannot close, re-open or free the probe slot */
+static void breaker_record(CircuitBreaker *b, int probe, int upstream_healthy) {
+	pthread_mutex_lock(&b->lock);
+	if (!probe && b->state != BREAKER_CLOSED) {
+		pthread_mutex_unlock(&b->lock);
+		return;
+	}
+	if (upstream_healthy) {
+		b->state = BREAKER_CLOSED;
+		b->consecutive_failures = 0;
+	} else {
+		b->consecutive_failures++;
+		if (b->state == BREAKER_HALF_OPEN || b->consecutive_failures >= b->failure_threshold) {
+			b->state = BREAKER_OPEN;
+			b->opened_at_ms = monotonic_ms();
+		}
+	}
+	b->probe_in_flight = 0;
+	pthread_mutex_unlock(&b->lock);
+}
+
+static int is_retryable_curl_error(CURLcode res) {
+	switch (res) {
+		case CURLE_COULDNT_CONNECT:
+		case CURLE_OPERATION_TIMEDOUT:
+		case CURLE_SEND_ERROR:
+		case CURLE_RECV_ERROR:
+		case CURLE_GOT_NOTHING:
+		case CURLE_PARTIAL_FILE:
+		case CURLE_SSL_CONNECT_ERROR:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/* Full-jitter exponential backoff: uniform in [0, min(max, base * 2^(attempt-1))] */
+static long backoff_delay_ms(const RetryPolicy *policy, int attempt) {
+	long cap = policy->base_backoff_ms;
+	for (int i = 1; i < attempt && cap < policy->max_backoff_ms; ++i) cap *= 2;
+	if (cap > policy->max_backoff_ms) cap = policy->max_backoff_ms;
+	return (long)(((double)random_next() / (double)RAND_MAX) * (double)cap);
+}
+
+/* ---------------- Upstream Metrics ---------------- */
+
+#define HIST_MAX_BOUNDS 16
+
+/* Fixed-bucket histogram; counts[nbounds] is the +Inf bucket */
+typedef struct {
+	const double *bounds;
+	int nbounds;
+	unsigned long counts[HIST_MAX_BOUNDS + 1];
+	unsigned long count;
+	unsigned long zeros; /* exact zeros within counts[0], e.g. reused connections */
+	double sum;
+	double min;
+	double max;
+} Histogram;
+
+static const double seconds_bounds[] = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+static const double bytes_bounds[] = {256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304};
+static const double attempts_bounds[] = {1, 2, 3, 4, 5};
+
+#define NBOUNDS(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static void histogram_init(Histogram *h, const double *bounds, int nbounds) {
+	memset(h, 0, sizeof(*h));
+	h->bounds = bounds;
+	h->nbounds = nbounds;
+}
+
+static void histogram_observe(Histogram *h, double v) {
+	int i = 0;
+	while (i < h->nbounds && v > h->bounds[i]) i++;
+	h->counts[i]++;
+	if (v <= 0.0) h->zeros++;
+	if (h->count == 0 || v < h->min) h->min = v;
+	h->count++;
+	h->sum += v;
+	if (v > h->max) h->max = v;
+}
+
+/* Estimates quantile q like Prometheus' histogram_quantile: finds the
+ * bucket holding rank q * count and interpolates linearly between its lower
+ * edge (0 or the previous bound) and its upper bound. The observed min and
+ * max clamp both edges, and the max stands in for the +Inf bound. Exact
+ * zeros are kept apart so a phase that is usually skipped reports 0 rather
+ * than a share of its rare nonzero samples. */
+static double histogram_quantile(const Histogram *h, double q) {
+	if (h->count == 0) return 0.0;
+	double rank = q * (double)h->count;
+	if (rank <= (double)h->zeros) return 0.0;
+	unsigned long acc = h->zeros;
+	for (int i = 0; i <= h->nbounds; ++i) {
+		unsigned long n = i == 0 ? h->counts[0] - h->zeros : h->counts[i];
+		if (n == 0 || (double)(acc + n) < rank) {
+			acc += n;
+			continue;
+		}
+		double lower = i > 0 ? h->bounds[i - 1] : 0.0;
+		if (lower < h->min) lower = h->min;
+		double upper = i < h->nbounds && h->bounds[i] < h->max ? h->bounds[i] : h->max;
+		if (upper < lower) upper = lower;
+		return lower + (upper - lower) * (rank - (double)acc) / (double)n;
+	}
+	return h->max;
+}
+
+/* Per-attempt transfer phases, derived from libcurl's cumulative timers */
+typedef enum {
+	PHASE_DNS = 0,
+	PHASE_CONNECT,
+	PHASE_TLS,
+	PHASE_TTFB,
+	PHASE_TRANSFER,
+	PHASE_TOTAL,
+	PHASE_COUNT
+} TransferPhase;
+
+static const char *phase_names[PHASE_COUNT] = {"dns", "connect", "tls", "ttfb", "transfer", "total"};
+
+typedef enum {
+	OUTCOME_OK = 0,
+	OUTCOME_HTTP_4XX,
+	OUTCOME_HTTP_429,
+	OUTCOME_HTTP_5XX,
+	OUTCOME_TRANSPORT,
+	OUTCOME_BREAKER_OPEN,
+	OUTCOME_DEADLINE,
+	OUTCOME_CANCELLED,
+	OUTCOME_COUNT
+} UpstreamOutcome;
+
+static const char *outcome_names[OUTCOME_COUNT] = {"ok", "http_4xx", "http_429", "http_5xx", "transport_error", "breaker_open", "deadline_exceeded", "cancelled"};
+
+typedef struct {
+	pthread_mutex_t lock;
+	Histogram phases[PHASE_COUNT];
+	Histogram response_bytes;
+	Histogram attempts;
+	Histogram parse_seconds;
+	unsigned long outcomes[OUTCOME_COUNT];
+	unsigned long cache_hits;
+	unsigned long prefetch_hits;
+} EndpointMetrics;
+
+static void metrics_init(EndpointMetrics *m) {
+	memset(m, 0, sizeof(*m));
+	pthread_mutex_init(&m->lock, NULL);
+	for (int p = 0; p < PHASE_COUNT; ++p) histogram_init(&m->phases[p], seconds_bounds, NBOUNDS(seconds_bounds));
+	histogram_init(&m->response_bytes, bytes_bounds, NBOUNDS(bytes_bounds));
+	histogram_init(&m->attempts, attempts_bounds, NBOUNDS(attempts_bounds));
+	histogram_init(&m->parse_seconds, seconds_bounds, NBOUNDS(seconds_bounds));
+}
+
+static double curl_seconds(CURL *curl, CURLINFO info) {
+	curl_off_t us = 0;
+	if (curl_easy_getinfo(curl, info, &us) != CURLE_OK) return 0.0;
+	return (double)us / 1e6;
+}
+
+static double phase_delta(double later, double earlier) {
+	return (later > earlier) ? later - earlier : 0.0;
+}
+
+static void metrics_record_attempt(EndpointMetrics *m, CURL *curl, CURLcode res, long http_code, size_t bytes) {
+	double dns = curl_seconds(curl, CURLINFO_NAMELOOKUP_TIME_T);
+	double connect = curl_seconds(curl, CURLINFO_CONNECT_TIME_T);
+	double tls = curl_seconds(curl, CURLINFO_APPCONNECT_TIME_T);
+	double pre = curl_seconds(curl, CURLINFO_PRETRANSFER_TIME_T);
+	double first_byte = curl_seconds(curl, CURLINFO_STARTTRANSFER_TIME_T);
+	double total = curl_seconds(curl, CURLINFO_TOTAL_TIME_T);
+	UpstreamOutcome outcome;
+	if (res != CURLE_OK) outcome = OUTCOME_TRANSPORT;
+	else if (http_code == 429) outcome = OUTCOME_HTTP_429;
+	else if (http_code >= 500) outcome = OUTCOME_HTTP_5XX;
+	else if (http_code >= 400) outcome = OUTCOME_HTTP_4XX;
+	else outcome = OUTCOME_OK;
+	pthread_mutex_lock(&m->lock);
+	histogram_observe(&m->phases[PHASE_DNS], dns);
+	histogram_observe(&m->phases[PHASE_CONNECT], phase_delta(connect, dns));
+	/* APPCONNECT stays 0 for plain HTTP and reused connections */
+	histogram_observe(&m->phases[PHASE_TLS], tls > 0.0 ? phase_delta(tls, connect) : 0.0);
+	histogram_observe(&m->phases[PHASE_TTFB], phase_delta(first_byte, pre));
+	histogram_observe(&m->phases[PHASE_TRANSFER], phase_delta(total, first_byte));
+	histogram_observe(&m->phases[PHASE_TOTAL], total);
+	if (res == CURLE_OK) histogram_observe(&m->response_bytes, (double)bytes);
+	m->outcomes[outcome]++;
+	pthread_mutex_unlock(&m->lock);
+}
+
+static void metrics_record_call(EndpointMetrics *m, int attempts, UpstreamOutcome rejected) {
+	pthread_mutex_lock(&m->lock);
+	if (attempts > 0) histogram_observe(&m->attempts, (double)attempts);
+	if (rejected != OUTCOME_OK) m->outcomes[rejected]++;
+	pthread_mutex_unlock(&m->lock);
+}
+
+static void metrics_record_cache_hit(EndpointMetrics *m) {
+	pthread_mutex_lock(&m->lock);
+	m->cache_hits++;
+	pthread_mutex_unlock(&m->lock);
+}
+
+/* A call answered by a prefetch; the prefetch's own attempt is already counted */
+static void metrics_record_prefetch_hit(EndpointMetrics *m) {
+	pthread_mutex_lock(&m->lock);
+	m->prefetch_hits++;
+	pthread_mutex_unlock(&m->lock);
+}
+
+static void metrics_record_parse(EndpointMetrics *m, double seconds) {
+	pthread_mutex_lock(&m->lock);
+	histogram_observe(&m->parse_seconds, seconds);
+	pthread_mutex_unlock(&m->lock);
+}
+
+/* ---------------- Single-Flight Request Coalescing ---------------- */
+
+/* Canonical form of a request URL so equivalent requests share one key:
+ * scheme and host are lowercased, default ports and fragments dropped,
+ * percent-escapes uppercased and query parameters sorted. */
+static int compare_cstr(const void *a, const void *b) {
+	return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static int normalize_url(const char *url, char *out, size_t outsz) {
+	const char *scheme_end = strstr(url, "://");
+	if (!scheme_end) return 0;
+	const char *host = scheme_end + 3;
+	size_t host_len = strcspn(host, "/?#");
+	const char *path = host + host_len;
+	size_t path_len = strcspn(path, "?#");
+	const char *query = (path[path_len] == '?') ? path + path_len + 1 : NULL;
+	size_t query_len = query ? strcspn(query, "#") : 0;
+
+	MemoryBuffer norm = {0};
+	for (const char *p = url; p < host; ++p) {
+		char c = (char)tolower((unsigned char)*p);
+		buffer_append(&norm, &c, 1);
+	}
+	int https = strncmp(norm.data, "https", 5) == 0;
+	size_t keep = host_len;
+	if (host_len > 3 && !https && strncmp(host + host_len - 3, ":80", 3) == 0) keep -= 3;
+	if (host_len > 4 && https && strncmp(host + host_len - 4, ":443", 4) == 0) keep -= 4;
+	for (size_t i = 0; i < keep; ++i) {
+		char c = (char)tolower((unsigned char)host[i]);
+		buffer_append(&norm, &c, 1);
+	}
+	if (path_len > 0) buffer_append(&norm, path, path_len);
+	else buffer_append(&norm, "/", 1);
+
+	if (query && query_len > 0) {
+		char *qcopy = (char *)malloc(query_len + 1);
+		if (!qcopy) { free(norm.data); return 0; }
+		memcpy(qcopy, query, query_len);
+		qcopy[query_len] = '\0';
+		for (char *p = qcopy; *p; ++p) {
+			if (*p == '%' && isxdigit((unsigned char)p[1]) && isxdigit((unsigned char)p[2])) {
+				p[1] = (char)toupper((unsigned char)p[1]);
+				p[2] = (char)toupper((unsigned char)p[2]);
+				p += 2;
+			}
+		}
+		char *params[64];
+		int n = 0;
+		char *save = NULL;
+		for (char *tok = strtok_r(qcopy, "&", &save); tok && n < 64; tok = strtok_r(NULL, "&", &save)) params[n++] = tok;
+		qsort(params, (size_t)n, sizeof(params[0]), compare_cstr);
+		for (int i = 0; i < n; ++i) {
+			buffer_append(&norm, i ? "&" : "?", 1);
+			buffer_append(&norm, params[i], strlen(params[i]));
+		}
+		free(qcopy);
+	}
+	int fits = norm.data && norm.size < outsz;
+	if (fits) memcpy(out, norm.data, norm.size + 1);
+	free(norm.data);
+	return fits;
+}
+
+/* Fills out (value_size bytes) and returns 1 on success */
+typedef int (*FlightLoader)(void *arg, void *out);
+
+typedef struct FlightCall {
+	char *key;
+	int done;
+	int ok;
+	int handoff; /* finished without a value; followers look the key up again */
+	void *value;
+	int waiters;
+	struct FlightCall *next;
+} FlightCall;
+
+/* Concurrent callers asking for the same key wait on the first caller's
+ * load and receive a copy of its parsed result. Completed calls leave the
+ * table immediately; repeat lookups are the response cache's job. */
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t finished;
+	FlightCall *calls;
+} SingleFlight;
+
+static void singleflight_init(SingleFlight *g) {
+	pthread_mutex_init(&g->lock, NULL);
+	pthread_cond_init(&g->finished, NULL);
+	g->calls = NULL;
+}
+
+static void singleflight_destroy(SingleFlight *g) {
+	pthread_cond_destroy(&g->finished);
+	pthread_mutex_destroy(&g->lock);
+}
+
+static void flight_free(FlightCall *call) {
+	free(call->key);
+	free(call->value);
+	free(call);
+}
+
+static FlightCall *flight_find(SingleFlight *g, const char *key) {
+	FlightCall *call = g->calls;
+	while (call && strcmp(call->key, key) != 0) call = call->next;
+	return call;
+}
+
+static FlightCall *flight_new(SingleFlight *g, const char *key) {
+	FlightCall *call = (FlightCall *)calloc(1, sizeof(FlightCall));
+	if (call) call->key = strdup(key);
+	if (!call || !call->key) {
+		free(call);
+		return NULL;
+	}
+	call->next = g->calls;
+	g->calls = call;
+	return call;
+}
+
+/* Marks call done and takes it out of the table; lock held */
+static void flight_finish(SingleFlight *g, FlightCall *call) {
+	call->done = 1;
+	FlightCall **pp = &g->calls;
+	while (*pp && *pp != call) pp = &(*pp)->next;
+	if (*pp) *pp = call->next;
+	if (call->waiters == 0) flight_free(call);
+	else pthread_cond_broadcast(&g->finished);
+}
+
+/* Follower: wait for the leader, but no longer than our own budget. Called
+ * with the lock held and call->waiters already counted; returns call->done.
+ * Condvars time out against CLOCK_REALTIME (macOS cannot switch them to
+ * CLOCK_MONOTONIC), so the remaining budget is rebased onto it. */
+static int flight_wait(SingleFlight *g, FlightCall *call, const Deadline *deadline) {
+	long remaining = deadline_remaining_ms(deadline);
+	if (remaining < 0) remaining = 0;
+	struct timespec until;
+	clock_gettime(CLOCK_REALTIME, &until);
+	until.tv_sec += (time_t)(remaining / 1000);
+	until.tv_nsec += (remaining % 1000) * 1000000L;
+	if (until.tv_nsec >= 1000000000L) {
+		until.tv_sec++;
+		until.tv_nsec -= 1000000000L;
+	}
+	while (!call->done) {
+		if (pthread_cond_timedwait(&g->finished, &g->lock, &until) == ETIMEDOUT) break;
+	}
+	return call->done;
+}
+
+static void flight_unwait(FlightCall *call) {
+	call->waiters--;
+	if (call->done && call->waiters == 0) flight_free(call);
+}
+
+/* Registers key without a loader, for work that fills the response cache
+ * itself (prefetch transfers, raw pages). Returns NULL when key is already
+ * in flight; otherwise finish with singleflight_handoff. */
+static FlightCall *singleflight_claim(SingleFlight *g, const char *key) {
+	pthread_mutex_lock(&g->lock);
+	FlightCall *call = flight_find(g, key) ? NULL : flight_new(g, key);
+	pthread_mutex_unlock(&g->lock);
+	return call;
+}
+
+/* Ends a claimed call. Its followers look the key up again and normally
+ * find the response in the cache; if it failed, one of them fetches it. */
+static void singleflight_handoff(SingleFlight *g, FlightCall *call) {
+	pthread_mutex_lock(&g->lock);
+	call->handoff = 1;
+	flight_finish(g, call);
+	pthread_mutex_unlock(&g->lock);
+}
+
+/* Waits for any in-flight call on key to finish. Returns 0 if the deadline
+ * ran out first */
+static int singleflight_await(SingleFlight *g, const char *key, const Deadline *deadline) {
+	pthread_mutex_lock(&g->lock);
+	FlightCall *call = flight_find(g, key);
+	int done = 1;
+	if (call) {
+		call->waiters++;
+		done = flight_wait(g, call, deadline);
+		flight_unwait(call);
+	}
+	pthread_mutex_unlock(&g->lock);
+	return done;
+}
+
+static int singleflight_do(SingleFlight *g, const char *key, const Deadline *deadline, FlightLoader load, void *arg, void *out, size_t value_size) {
+	FlightCall *call;
+	for (;;) {
+		pthread_mutex_lock(&g->lock);
+		call = flight_find(g, key);
+		if (!call) break;
+		call->waiters++;
+		int done = flight_wait(g, call, deadline);
+		int handoff = done && call->handoff;
+		int ok = done && call->ok;
+		if (ok) memcpy(out, call->value, value_size);
+		flight_unwait(call);
+		pthread_mutex_unlock(&g->lock);
+		if (!handoff) return ok;
+	}
+
+	call = flight_new(g, key);
+	pthread_mutex_unlock(&g->lock);
+	if (!call) return load(arg, out);
+
+	int ok = load(arg, out);
+
+	pthread_mutex_lock(&g->lock);
+	if (ok && call->waiters > 0) {
+		call->value = malloc(value_size);
+		if (call->value) memcpy(call->value, out, value_size);
+	}
+	call->ok = ok && call->value;
+	flight_finish(g, call);
+	pthread_mutex_unlock(&g->lock);
+	return ok;
+}
+
+/* ---------------- Shared Upstream Client ---------------- */
+
+typedef struct {
+	const char *name;
+	char base_url[256];
+	CircuitBreaker breaker;
+	atomic_ulong requests; /* attempts actually sent */
+	EndpointMetrics metrics;
+} UpstreamEndpoint;
+
+/* One client per process. DNS results and TLS sessions live in a curl share
+ * object so every thread can resume sessions; live connections stay with the
+ * calling thread's persistent easy handle, and prefetch connections with its
+ * persistent multi handle (connection caches are not safely shareable
+ * across threads). */
+typedef struct {
+	UpstreamEndpoint openweather;
+	UpstreamEndpoint ticketmaster;
+	RetryPolicy retry;
+	CURLSH *share;
+	pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+	ResponseCache weather_cache;
+	ResponseCache events_cache;
+	SingleFlight flights;
+	atomic_long events_per_day_milli; /* observed Ticketmaster density for ranged planning; 0 until seen */
+} UpstreamClient;
+
+static _Thread_local CURL *thread_easy = NULL;
+static _Thread_local CURLM *thread_multi = NULL;
+
+static void share_lock_cb(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+	(void)handle; (void)access;
+	UpstreamClient *client = (UpstreamClient *)userptr;
+	pthread_mutex_lock(&client->share_locks[data]);
+}
+
+static void share_unlock_cb(CURL *handle, curl_lock_data data, void *userptr) {
+	(void)handle;
+	UpstreamClient *client = (UpstreamClient *)userptr;
+	pthread_mutex_unlock(&client->share_locks[data]);
+}
+
+static void read_base_url(const char *env_name, const char *fallback, char *out, size_t outsz) {
+	const char *v = getenv(env_name);
+	snprintf(out, outsz, "%s", (v && *v) ? v : fallback);
+	/* Drop trailing slashes so paths can be appended verbatim */
+	size_t n = strlen(out);
+	while (n > 0 && out[n - 1] == '/') out[--n] = '\0';
+}
+
+static int upstream_client_init(UpstreamClient *client) {
+	memset(client, 0, sizeof(*client));
+	/* Base URLs are overridable so a local stand-in upstream can be used */
+	client->openweather.name = "openweather";
+	client->ticketmaster.name = "ticketmaster";
+	read_base_url("OPENWEATHER_BASE_URL", "https://api.openweathermap.org", client->openweather.base_url, sizeof(client->openweather.base_url));
+	read_base_url("TICKETMASTER_BASE_URL", "https://app.ticketmaster.com", client->ticketmaster.base_url, sizeof(client->ticketmaster.base_url));
+	breaker_init(&client->openweather.breaker, 5, 30000);
+	breaker_init(&client->ticketmaster.breaker, 5, 30000);
+	metrics_init(&client->openweather.metrics);
+	metrics_init(&client->ticketmaster.metrics);
+	client->retry = default_retry_policy;
+	for (int i = 0; i < CURL_LOCK_DATA_LAST; ++i) pthread_mutex_init(&client->share_locks[i], NULL);
+	client->share = curl_share_init();
+	if (!client->share) return 0;
+	curl_share_setopt(client->share, CURLSHOPT_LOCKFUNC, share_lock_cb);
+	curl_share_setopt(client->share, CURLSHOPT_UNLOCKFUNC, share_unlock_cb);
+	curl_share_setopt(client->share, CURLSHOPT_USERDATA, client);
+	curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	/* Current conditions change slowly; event listings even more so */
+	cache_init(&client->weather_cache, 600);
+	cache_init(&client->events_cache, 1800);
+	singleflight_init(&client->flights);
+	return 1;
+}
+
+/* Releases the calling thread's persistent handles; call before a thread exits */
+static void upstream_thread_release(void) {
+	if (thread_easy) {
+		curl_easy_cleanup(thread_easy);
+		thread_easy = NULL;
+	}
+	if (thread_multi) {
+		curl_multi_cleanup(thread_multi);
+		thread_multi = NULL;
+	}
+}
+
+static void upstream_client_cleanup(UpstreamClient *client) {
+	upstream_thread_release();
+	if (client->share) curl_share_cleanup(client->share);
+	client->share = NULL;
+	for (int i = 0; i < CURL_LOCK_DATA_LAST; ++i) pthread_mutex_destroy(&client->share_locks[i]);
+	pthread_mutex_destroy(&client->openweather.breaker.lock);
+	pthread_mutex_destroy(&client->ticketmaster.breaker.lock);
+	pthread_mutex_destroy(&client->openweather.metrics.lock);
+	pthread_mutex_destroy(&client->ticketmaster.metrics.lock);
+	cache_destroy(&client->weather_cache);
+	cache_destroy(&client->events_cache);
+	singleflight_destroy(&client->flights);
+}
+
+static CURL *upstream_handle(UpstreamClient *client) {
+	if (!thread_easy) thread_easy = curl_easy_init();
+	if (!thread_easy) return NULL;
+	/* Reset keeps live connections and caches but clears per-request options */
+	curl_easy_reset(thread_easy);
+	curl_easy_setopt(thread_easy, CURLOPT_SHARE, client->share);
+	return thread_easy;
+}
+
+/* The calling thread's multi handle; it keeps connections open between
+ * prefetch rounds the way thread_easy does for single calls */
+static CURLM *upstream_multi(void) {
+	if (!thread_multi) thread_multi = curl_multi_init();
+	return thread_multi;
+}
+
+/* The retry loop behind upstream_get. Reports how many attempts were sent
+ * and, when it gave up without a final answer, why. */
+static int upstream_transfer(UpstreamClient *client, UpstreamEndpoint *endpoint, const Deadline *deadline, const char *url, char **out_json, int *attempts_out, UpstreamOutcome *rejected) {
+	const RetryPolicy *policy = &client->retry;
+	for (int attempt = 1; attempt <= policy->max_attempts; ++attempt) {
+		long remaining = deadline_remaining_ms(deadline);
+		if (remaining <= 0) { *rejected = OUTCOME_DEADLINE; return 0; }
+		/* Get the handle first so a failure here cannot strand a half-open probe */
+		CURL *curl = upstream_handle(client);
+		if (!curl) { *rejected = OUTCOME_TRANSPORT; return 0; }
+		int allowed = breaker_allow(&endpoint->breaker);
+		if (!allowed) { *rejected = OUTCOME_BREAKER_OPEN; return 0; }
+		int probe = allowed == 2;
+		atomic_fetch_add(&endpoint->requests, 1);
+		*attempts_out = attempt;
+		long timeout = remaining < policy->attempt_timeout_ms ? remaining : policy->attempt_timeout_ms;
+		long connect_timeout = timeout < policy->connect_timeout_ms ? timeout : policy->connect_timeout_ms;
 		MemoryBuffer chunk = {0};
 		curl_easy_setopt(curl, CURLOPT_URL, url);
 		curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-		curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+		curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout);
+		curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout);
+		curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
 		curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
 		CURLcode res = curl_easy_perform(curl);
 		long http_code = 0;
 		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+		metrics_record_attempt(&endpoint->metrics, curl, res, http_code, chunk.size);
 		if (res == CURLE_OK && http_code >= 200 && http_code < 300 && chunk.data && chunk.size > 0) {
+			breaker_record(&endpoint->breaker, probe, 1);
 			*out_json = chunk.data;
-			curl_easy_cleanup(curl);
 			return 1;
 		}
 		free(chunk.data);
+
+		int retryable;
+		if (res != CURLE_OK) {
+			retryable = is_retryable_curl_error(res);
+			breaker_record(&endpoint->breaker, probe, 0);
+		} else if (http_code >= 500) {
+			retryable = 1;
+			breaker_record(&endpoint->breaker, probe, 0);
+		} else {
+			/* 429 means throttled, not down; other 4xx will not improve on retry */
+			retryable = (http_code == 429);
+			breaker_record(&endpoint->breaker, probe, 1);
+		}
+		if (!retryable || attempt == policy->max_attempts) return 0;
+
+		long delay = backoff_delay_ms(policy, attempt);
+		curl_off_t retry_after = 0;
+		if ((http_code == 429 || http_code == 503) &&
+			curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+			long hinted = (long)retry_after * 1000L;
+			if (hinted > delay) delay = hinted;
+		}
+		/* Sleeping past the deadline cannot lead to a usable answer */
+		if (delay >= deadline_remaining_ms(deadline)) { *rejected = OUTCOME_DEADLINE; return 0; }
+		sleep_ms(delay);
 	}
-	curl_easy_cleanup(curl);
 	return 0;
 }
 
+/* GET url into a heap buffer, consulting cache first. Retries transport
+ * errors, 5xx and 429 with jittered backoff, never past the deadline, and
+ * fails fast while the endpoint's breaker is open. Returns 1 on success */
+static int upstream_get(UpstreamClient *client, UpstreamEndpoint *endpoint, ResponseCache *cache, const Deadline *deadline, const char *url, char **out_json) {
+	int prefetched = 0;
+	char *cached = cache_get(cache, url, &prefetched);
+	if (cached) {
+		if (prefetched) metrics_record_prefetch_hit(&endpoint->metrics);
+		else metrics_record_cache_hit(&endpoint->metrics);
+		*out_json = cached;
+		return 1;
+	}
+	int attempts = 0;
+	UpstreamOutcome rejected = OUTCOME_OK;
+	int ok = upstream_transfer(client, endpoint, deadline, url, out_json, &attempts, &rejected);
+	metrics_record_call(&endpoint->metrics, attempts, rejected);
+	if (ok) cache_put(cache, url, *out_json, 0);
+	return ok;
+}
+
+/* Builds the normalized request URL, which doubles as cache and flight key */
+static int openweather_url(UpstreamClient *client, const char *city, const char *api_key, char *url, size_t urlsz) {
+	CURL *curl = upstream_handle(client);
+	if (!curl) return 0;
+	char *city_enc = curl_easy_escape(curl, city, 0);
+	if (!city_enc) return 0;
+	char raw[768];
+	snprintf(raw, sizeof(raw), "%s/data/2.5/weather?q=%s&appid=%s", client->openweather.base_url, city_enc, api_key);
+	curl_free(city_enc);
+	return normalize_url(raw, url, urlsz);
+}
+
+static int fetch_openweather_json(UpstreamClient *client, const Deadline *deadline, const char *url, char **out_json) {
+	if (!client || !deadline || !url || !out_json) return 0;
+	return upstream_get(client, &client->openweather, &client->weather_cache, deadline, url, out_json);
+}
+
 static int extract_json_string_field(const char *json, const char *key, char *out, size_t outsz) {
 	/* naive extractor for patterns like \"main\":\"Clear\" within objects */
 	if (!json || !key || !out || outsz == 0) return 0;
@@ -336,202 +1229,2838 @@ static WeatherType map_openweather_main_to_type(const char *main_str) {
 	return WEATHER_ANY;
 }
 
-static int list_activity_ideas(WeatherType w, Season s, char ideas[][96], int maxIdeas) {
-	/* Populate up to maxIdeas short activity strings */
-	int count = 0;
-	#define ADD_IDEA(str) do { if (count < maxIdeas) { strncpy(ideas[count], (str), 95); ideas[count][95] = '\0'; count++; } } while (0)
-	if (w == WEATHER_SUNNY) {
-		if (s == SEASON_SUMMER) {
-			ADD_IDEA("Beach day and picnic");
-			ADD_IDEA("Sunset hike");
-			ADD_IDEA("Outdoor concert");
-			ADD_IDEA("Kayaking on a lake");
-		} else if (s == SEASON_SPRING) {
-			ADD_IDEA("Botanical garden visit");
-			ADD_IDEA("City bike tour");
-			ADD_IDEA("Farmer's market stroll");
-		} else if (s == SEASON_FALL) {
-			ADD_IDEA("Scenic foliage drive");
-			ADD_IDEA("Pumpkin patch + cider");
-			ADD_IDEA("Harvest festival");
-		} else {
-			ADD_IDEA("Sunny winter walk");
-			ADD_IDEA("Outdoor photography");
-		}
-	} else if (w == WEATHER_RAINY) {
-		ADD_IDEA("Museum afternoon");
-		ADD_IDEA("Cozy cafe and book");
-		ADD_IDEA("Aquarium visit");
-		if (s == SEASON_SPRING || s == SEASON_FALL) ADD_IDEA("Rainy day ramen crawl");
-	} else if (w == WEATHER_SNOWY) {
-		ADD_IDEA("Sledding at a local hill");
-		ADD_IDEA("Ice skating rink");
-		ADD_IDEA("Snowshoe trail");
-		ADD_IDEA("Hot chocolate and movie night");
-	} else if (w == WEATHER_WINDY) {
-		ADD_IDEA("Kite flying");
-		ADD_IDEA("Coastal walk");
-		ADD_IDEA("Art gallery visit");
-	} else if (w == WEATHER_CLOUDY) {
-		ADD_IDEA("Matinee at the theater");
-		ADD_IDEA("Board game cafe");
-		ADD_IDEA("Local brewery tour");
-	} else if (w == WEATHER_STORMY) {
-		ADD_IDEA("Home cooking class night");
-		ADD_IDEA("Planetarium or science center");
-		ADD_IDEA("Spa day");
-	} else {
-		ADD_IDEA("Surprise local event");
-		ADD_IDEA("New restaurant tryout");
+/* ---------------- Mapped Data Files ---------------- */
+
+/* Maps a whole file read-only. Returns 1 and sets *base / *size on success */
+static int map_readonly_file(const char *path, const char **base, size_t *size) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return 0;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return 0;
 	}
-	#undef ADD_IDEA
-	return count;
+	void *mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) return 0;
+	*base = (const char *)mem;
+	*size = (size_t)st.st_size;
+	return 1;
 }
 
-typedef struct {
-	int year;
-	int month;
-	int day;
-	char activity[96];
-} ActivityOption;
+static char *read_text_file(const char *path) {
+	FILE *in = fopen(path, "rb");
+	if (!in) return NULL;
+	MemoryBuffer text = {0};
+	char chunk[4096];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) buffer_append(&text, chunk, n);
+	fclose(in);
+	return text.data ? text.data : strdup("");
+}
 
-static int generate_activity_options(Hemisphere hemi, WeatherType weather, ActivityOption *options, int maxOptions) {
-	if (!options || maxOptions <= 0) return 0;
-	/* Create activities list based on the season of the picked month for each option */
-	int produced = 0;
-	/* attempt to produce up to maxOptions unique-looking pairs */
-	for (int i = 0; i < maxOptions * 2 && produced < maxOptions; ++i) {
-		int y, m, d;
-		pick_date(hemi, weather, &y, &m, &d);
-		Season s = month_to_season(m, hemi);
-		char ideas[8][96];
-		int n = list_activity_ideas(weather, s, ideas, 8);
-		if (n <= 0) continue;
-		const char *idea = ideas[rand() % n];
-		/* ensure not a duplicate of immediate previous */
-		int dup = 0;
-		for (int k = 0; k < produced; ++k) {
-			if (options[k].year == y && options[k].month == m && options[k].day == d && strcmp(options[k].activity, idea) == 0) {
-				dup = 1; break;
-			}
-		}
-		if (dup) continue;
-		options[produced].year = y;
-		options[produced].month = m;
-		options[produced].day = d;
-		strncpy(options[produced].activity, idea, sizeof(options[produced].activity) - 1);
-		options[produced].activity[sizeof(options[produced].activity) - 1] = '\0';
-		produced++;
-	}
-	return produced;
+static int write_binary_file(const char *path, const MemoryBuffer *image) {
+	FILE *out = fopen(path, "wb");
+	int ok = out && fwrite(image->data, 1, image->size, out) == image->size;
+	if (out && fclose(out) != 0) ok = 0;
+	return ok;
 }
 
-/* ---------------- Ticketmaster Discovery API Integration ---------------- */
+/* ---------------- Activity Catalog ---------------- */
 
-static char *url_encode_component(CURL *curl, const char *s) {
-	if (!s) return NULL;
-	char *escaped = curl_easy_escape(curl, s, 0);
-	if (!escaped) return NULL;
-	/* Caller must free via curl_free */
-	return escaped;
-}
+/* A catalog is one read-only image, normally mmap'd straight from disk:
+ *
+ *   CatalogHeader
+ *   CatalogSlot index[WEATHER_COUNT][SEASON_COUNT]   -> ranges of entries
+ *   uint32_t entries[entry_count]                    -> offsets into strings
+ *   char strings[strings_size]                       -> NUL-terminated, deduplicated
+ *
+ * Options point straight into the string table, so an idea is stored once
+ * no matter how many (weather, season) slots or options reference it. */
+#define CATALOG_MAGIC "DPCAT01"
+#define WEATHER_COUNT (WEATHER_ANY + 1)
+#define SEASON_COUNT 4
 
-static void format_date_range_utc(int year, int month, int day, char *start_iso, size_t start_sz, char *end_iso, size_t end_sz) {
+typedef struct {
+	char magic[8];
+	uint32_t entry_count;
+	uint32_t strings_size;
+	uint32_t index_offset;
+	uint32_t entries_offset;
+	uint32_t strings_offset;
+	uint32_t reserved;
+} CatalogHeader;
+
+typedef struct {
+	uint32_t first;
+	uint32_t count;
+} CatalogSlot;
+
+typedef struct {
+	const char *base;
+	size_t size;
+	int mapped; /* 1: munmap on close, 0: heap image */
+	const CatalogSlot *index;
+	const uint32_t *entries;
+	const char *strings;
+} ActivityCatalog;
+
+static const char *const weather_names[WEATHER_COUNT] = {"sunny", "rainy", "snowy", "windy", "cloudy", "stormy", "any"};
+static const char *const season_names[SEASON_COUNT] = {"winter", "spring", "summer", "fall"};
+
+/* Source format: "<weather> <season[,season...]|*> <activity text>" per line, '#' comments.
+ * This is the only copy of the default list; --print-builtin catalog writes
+ * it out as a starting point for --build-catalog. */
+static const char builtin_catalog_source[] =
+	"# Activity catalog source. Compile with:\n"
+	"#   ./datePicker_app --build-catalog activities.txt activities.cat\n"
+	"# then run with --catalog activities.cat (or DATEPICKER_CATALOG=activities.cat).\n"
+	"# Format: <weather> <season[,season...]|*> <activity text>\n"
+	"#   weather: sunny rainy snowy windy cloudy stormy any\n"
+	"#   season:  winter spring summer fall, or * for all seasons\n"
+	"sunny summer Beach day and picnic\n"
+	"sunny summer Sunset hike\n"
+	"sunny summer Outdoor concert\n"
+	"sunny summer Kayaking on a lake\n"
+	"sunny spring Botanical garden visit\n"
+	"sunny spring City bike tour\n"
+	"sunny spring Farmer's market stroll\n"
+	"sunny fall Scenic foliage drive\n"
+	"sunny fall Pumpkin patch + cider\n"
+	"sunny fall Harvest festival\n"
+	"sunny winter Sunny winter walk\n"
+	"sunny winter Outdoor photography\n"
+	"rainy * Museum afternoon\n"
+	"rainy * Cozy cafe and book\n"
+	"rainy * Aquarium visit\n"
+	"rainy spring,fall Rainy day ramen crawl\n"
+	"snowy * Sledding at a local hill\n"
+	"snowy * Ice skating rink\n"
+	"snowy * Snowshoe trail\n"
+	"snowy * Hot chocolate and movie night\n"
+	"windy * Kite flying\n"
+	"windy * Coastal walk\n"
+	"windy * Art gallery visit\n"
+	"cloudy * Matinee at the theater\n"
+	"cloudy * Board game cafe\n"
+	"cloudy * Local brewery tour\n"
+	"stormy * Home cooking class night\n"
+	"stormy * Planetarium or science center\n"
+	"stormy * Spa day\n"
+	"any * Surprise local event\n"
+	"any * New restaurant tryout\n";
+
+static int lookup_name(const char *const *names, int count, const char *s, size_t len) {
+	for (int i = 0; i < count; ++i) {
+		if (strlen(names[i]) == len && strncmp(names[i], s, len) == 0) return i;
+	}
+	return -1;
+}
+
+typedef struct {
+	int weather;
+	unsigned season_mask;
+	uint32_t text;
+} CatalogRow;
+
+/* Appends s to the string table unless an identical string is already there */
+static uint32_t catalog_intern(MemoryBuffer *strings, uint32_t *table, size_t table_size, const char *s, size_t len) {
+	uint64_t h = 1469598103934665603ULL;
+	for (size_t i = 0; i < len; ++i) {
+		h ^= (unsigned char)s[i];
+		h *= 1099511628211ULL;
+	}
+	size_t slot = (size_t)(h & (table_size - 1));
+	while (table[slot] != UINT32_MAX) {
+		const char *existing = strings->data + table[slot];
+		if (strlen(existing) == len && memcmp(existing, s, len) == 0) return table[slot];
+		slot = (slot + 1) & (table_size - 1);
+	}
+	uint32_t off = (uint32_t)strings->size;
+	buffer_append(strings, s, len);
+	buffer_append(strings, "", 1);
+	table[slot] = off;
+	return off;
+}
+
+/* Compiles catalog source text into a catalog image. Returns 1 on success */
+static int catalog_build_image(const char *source, MemoryBuffer *image, char *err, size_t errsz) {
+	size_t max_rows = 1;
+	for (const char *p = source; *p; ++p) if (*p == '\n') max_rows++;
+	size_t table_size = 16;
+	while (table_size < max_rows * 2) table_size *= 2;
+	CatalogRow *rows = (CatalogRow *)malloc(max_rows * sizeof(CatalogRow));
+	uint32_t *table = (uint32_t *)malloc(table_size * sizeof(uint32_t));
+	MemoryBuffer strings = {0};
+	int ok = rows && table;
+	if (table) memset(table, 0xff, table_size * sizeof(uint32_t));
+
+	size_t nrows = 0;
+	int line_no = 0;
+	for (const char *line = source; ok && *line; ) {
+		const char *eol = strchr(line, '\n');
+		if (!eol) eol = line + strlen(line);
+		line_no++;
+		const char *p = line;
+		while (p < eol && isspace((unsigned char)*p)) p++;
+		const char *end = eol;
+		while (end > p && isspace((unsigned char)end[-1])) end--;
+		if (p < end && *p != '#') {
+			const char *w_end = p;
+			while (w_end < end && !isspace((unsigned char)*w_end)) w_end++;
+			const char *s_begin = w_end;
+			while (s_begin < end && isspace((unsigned char)*s_begin)) s_begin++;
+			const char *s_end = s_begin;
+			while (s_end < end && !isspace((unsigned char)*s_end)) s_end++;
+			const char *text = s_end;
+			while (text < end && isspace((unsigned char)*text)) text++;
+			int w = lookup_name(weather_names, WEATHER_COUNT, p, (size_t)(w_end - p));
+			unsigned mask = 0;
+			if (s_end - s_begin == 1 && *s_begin == '*') {
+				mask = (1u << SEASON_COUNT) - 1;
+			} else {
+				for (const char *s = s_begin; s < s_end; ) {
+					const char *comma = memchr(s, ',', (size_t)(s_end - s));
+					if (!comma) comma = s_end;
+					int season = lookup_name(season_names, SEASON_COUNT, s, (size_t)(comma - s));
+					if (season < 0) { mask = 0; break; }
+					mask |= 1u << season;
+					s = comma + 1;
+				}
+			}
+			if (w < 0 || mask == 0 || text >= end) {
+				snprintf(err, errsz, "line %d: expected '<weather> <season[,season]|*> <activity>'", line_no);
+				ok = 0;
+				break;
+			}
+			rows[nrows].weather = w;
+			rows[nrows].season_mask = mask;
+			rows[nrows].text = catalog_intern(&strings, table, table_size, text, (size_t)(end - text));
+			nrows++;
+		}
+		line = *eol ? eol + 1 : eol;
+	}
+	if (!rows || !table) snprintf(err, errsz, "out of memory");
+	/* An image with no strings would be rejected on load; refuse it here */
+	if (ok && nrows == 0) {
+		snprintf(err, errsz, "no activities");
+		ok = 0;
+	}
+
+	if (ok) {
+		CatalogHeader hdr;
+		CatalogSlot index[WEATHER_COUNT][SEASON_COUNT];
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.magic, CATALOG_MAGIC, sizeof(hdr.magic));
+		MemoryBuffer entries = {0};
+		uint32_t n = 0;
+		for (int w = 0; w < WEATHER_COUNT; ++w) {
+			for (int s = 0; s < SEASON_COUNT; ++s) {
+				index[w][s].first = n;
+				for (size_t r = 0; r < nrows; ++r) {
+					if (rows[r].weather == w && (rows[r].season_mask & (1u << s))) {
+						buffer_append(&entries, (const char *)&rows[r].text, sizeof(uint32_t));
+						n++;
+					}
+				}
+				index[w][s].count = n - index[w][s].first;
+			}
+		}
+		hdr.entry_count = n;
+		hdr.strings_size = (uint32_t)strings.size;
+		hdr.index_offset = (uint32_t)sizeof(hdr);
+		hdr.entries_offset = hdr.index_offset + (uint32_t)sizeof(index);
+		hdr.strings_offset = hdr.entries_offset + n * (uint32_t)sizeof(uint32_t);
+		image->size = 0;
+		buffer_append(image, (const char *)&hdr, sizeof(hdr));
+		buffer_append(image, (const char *)index, sizeof(index));
+		if (entries.size) buffer_append(image, entries.data, entries.size);
+		if (strings.size) buffer_append(image, strings.data, strings.size);
+		free(entries.data);
+		ok = image->size == hdr.strings_offset + hdr.strings_size;
+		if (!ok) snprintf(err, errsz, "out of memory");
+	}
+	free(rows);
+	free(table);
+	free(strings.data);
+	return ok;
+}
+
+/* Validates an image so later lookups can skip bounds checks */
+static int catalog_attach(ActivityCatalog *cat, const char *base, size_t size) {
+	if (size < sizeof(CatalogHeader)) return 0;
+	CatalogHeader hdr;
+	memcpy(&hdr, base, sizeof(hdr));
+	if (memcmp(hdr.magic, CATALOG_MAGIC, sizeof(hdr.magic)) != 0) return 0;
+	uint64_t index_end = (uint64_t)hdr.index_offset + sizeof(CatalogSlot) * WEATHER_COUNT * SEASON_COUNT;
+	uint64_t entries_end = (uint64_t)hdr.entries_offset + (uint64_t)hdr.entry_count * sizeof(uint32_t);
+	uint64_t strings_end = (uint64_t)hdr.strings_offset + hdr.strings_size;
+	if (index_end > size || entries_end > size || strings_end > size) return 0;
+	if (hdr.index_offset % 4 || hdr.entries_offset % 4) return 0;
+	if (hdr.strings_size == 0 || base[hdr.strings_offset + hdr.strings_size - 1] != '\0') return 0;
+	cat->base = base;
+	cat->size = size;
+	cat->index = (const CatalogSlot *)(base + hdr.index_offset);
+	cat->entries = (const uint32_t *)(base + hdr.entries_offset);
+	cat->strings = base + hdr.strings_offset;
+	for (int i = 0; i < WEATHER_COUNT * SEASON_COUNT; ++i) {
+		if ((uint64_t)cat->index[i].first + cat->index[i].count > hdr.entry_count) return 0;
+	}
+	for (uint32_t i = 0; i < hdr.entry_count; ++i) {
+		if (cat->entries[i] >= hdr.strings_size) return 0;
+	}
+	return 1;
+}
+
+static int catalog_open(ActivityCatalog *cat, const char *path) {
+	memset(cat, 0, sizeof(*cat));
+	const char *base = NULL;
+	size_t size = 0;
+	if (!map_readonly_file(path, &base, &size)) return 0;
+	if (!catalog_attach(cat, base, size)) {
+		munmap((void *)base, size);
+		memset(cat, 0, sizeof(*cat));
+		return 0;
+	}
+	cat->mapped = 1;
+	return 1;
+}
+
+static int catalog_load_builtin(ActivityCatalog *cat) {
+	memset(cat, 0, sizeof(*cat));
+	MemoryBuffer image = {0};
+	char err[128];
+	if (!catalog_build_image(builtin_catalog_source, &image, err, sizeof(err)) || !catalog_attach(cat, image.data, image.size)) {
+		free(image.data);
+		return 0;
+	}
+	return 1;
+}
+
+static void catalog_close(ActivityCatalog *cat) {
+	if (cat->mapped) munmap((void *)cat->base, cat->size);
+	else free((void *)cat->base);
+	memset(cat, 0, sizeof(*cat));
+}
+
+static int catalog_count(const ActivityCatalog *cat, WeatherType w, Season s) {
+	return (int)cat->index[(int)w * SEASON_COUNT + (int)s].count;
+}
+
+static const char *catalog_entry(const ActivityCatalog *cat, WeatherType w, Season s, int i) {
+	const CatalogSlot *slot = &cat->index[(int)w * SEASON_COUNT + (int)s];
+	return cat->strings + cat->entries[slot->first + (uint32_t)i];
+}
+
+/* --build-catalog: compile a source file into an image written to out_path */
+static int build_catalog_file(const char *src_path, const char *out_path) {
+	char *source = read_text_file(src_path);
+	if (!source) {
+		fprintf(stderr, "Cannot read %s\n", src_path);
+		return 1;
+	}
+	MemoryBuffer image = {0};
+	char err[128] = "empty source";
+	int ok = catalog_build_image(source, &image, err, sizeof(err));
+	free(source);
+	if (!ok) {
+		fprintf(stderr, "%s: %s\n", src_path, err);
+		free(image.data);
+		return 1;
+	}
+	ok = write_binary_file(out_path, &image);
+	if (ok) {
+		CatalogHeader hdr;
+		memcpy(&hdr, image.data, sizeof(hdr));
+		printf("Wrote %s: %u entries, %u bytes of interned text\n", out_path, hdr.entry_count, hdr.strings_size);
+	} else {
+		fprintf(stderr, "Cannot write %s\n", out_path);
+	}
+	free(image.data);
+	return ok ? 0 : 1;
+}
+
+/* ---------------- City Keys and Perfect Hashing ---------------- */
+
+/* Canonical lookup keys for a city string: lowercase, single spaces, and an
+ * optional ", CC" country suffix split off. "  New  York , us" gives
+ * full "new york,us" and name "new york"; without a suffix both are equal. */
+static int city_keys(const char *city, char *full, size_t full_sz, char *name, size_t name_sz) {
+	char tmp[160];
+	size_t n = 0;
+	int pending_space = 0;
+	for (const char *p = city; *p && n + 2 < sizeof(tmp); ++p) {
+		unsigned char c = (unsigned char)*p;
+		if (isspace(c)) { pending_space = n > 0; continue; }
+		if (c == ',') pending_space = 0;
+		else if (pending_space && tmp[n - 1] != ',') tmp[n++] = ' ';
+		pending_space = 0;
+		tmp[n++] = (char)tolower(c);
+	}
+	tmp[n] = '\0';
+	char *comma = strrchr(tmp, ',');
+	const char *cc = comma ? comma + 1 : "";
+	if (comma) {
+		*comma = '\0';
+		while (comma > tmp && comma[-1] == ' ') *--comma = '\0';
+	}
+	if (tmp[0] == '\0') return 0;
+	size_t name_len = strlen(tmp), cc_len = strlen(cc);
+	if (name_len + 1 + cc_len >= full_sz || name_len >= name_sz) return 0;
+	memcpy(name, tmp, name_len + 1);
+	memcpy(full, tmp, name_len + 1);
+	if (cc_len) {
+		full[name_len] = ',';
+		memcpy(full + name_len + 1, cc, cc_len + 1);
+	}
+	return 1;
+}
+
+static uint64_t seeded_hash(const char *s, uint32_t seed) {
+	uint64_t h = 1469598103934665603ULL ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ULL);
+	for (; *s; ++s) {
+		h ^= (unsigned char)*s;
+		h *= 1099511628211ULL;
+	}
+	/* murmur3 finalizer so nearby seeds give unrelated slots */
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* Minimal perfect hash (hash-and-displace): keys fall into buckets by one
+ * hash, and each bucket stores the seed that places all of its keys into
+ * free slots of a table exactly as large as the key set. */
+typedef struct {
+	uint32_t bucket_count;
+	uint32_t slot_count;
+	const uint32_t *seeds;
+} PerfectHash;
+
+static uint32_t mph_slot(const PerfectHash *ph, const char *key) {
+	uint32_t bucket = (uint32_t)(seeded_hash(key, 0) % ph->bucket_count);
+	return (uint32_t)(seeded_hash(key, ph->seeds[bucket]) % ph->slot_count);
+}
+
+typedef struct {
+	uint32_t bucket;
+	uint32_t size;
+	uint32_t first;
+} MphBucket;
+
+static int compare_bucket_size_desc(const void *a, const void *b) {
+	const MphBucket *x = (const MphBucket *)a, *y = (const MphBucket *)b;
+	if (x->size != y->size) return x->size < y->size ? 1 : -1;
+	return (x->bucket > y->bucket) - (x->bucket < y->bucket);
+}
+
+/* Fills seeds[bucket_count] and slot_of[n] (the slot each key landed in) */
+static int mph_build(const char *const *keys, uint32_t n, uint32_t bucket_count, uint32_t *seeds, uint32_t *slot_of) {
+	MphBucket *buckets = (MphBucket *)calloc(bucket_count, sizeof(MphBucket));
+	uint32_t *order = (uint32_t *)malloc((size_t)n * sizeof(uint32_t));
+	uint32_t *fill = (uint32_t *)calloc(bucket_count, sizeof(uint32_t));
+	unsigned char *taken = (unsigned char *)calloc(n ? n : 1, 1);
+	uint32_t trial[64];
+	int ok = buckets && order && fill && taken;
+	for (uint32_t b = 0; ok && b < bucket_count; ++b) buckets[b].bucket = b;
+	for (uint32_t i = 0; ok && i < n; ++i) buckets[seeded_hash(keys[i], 0) % bucket_count].size++;
+	/* Counting sort of key indices by bucket */
+	uint32_t acc = 0;
+	for (uint32_t b = 0; ok && b < bucket_count; ++b) {
+		buckets[b].first = acc;
+		acc += buckets[b].size;
+		if (buckets[b].size > 64) ok = 0;
+	}
+	for (uint32_t i = 0; ok && i < n; ++i) {
+		uint32_t b = (uint32_t)(seeded_hash(keys[i], 0) % bucket_count);
+		order[buckets[b].first + fill[b]++] = i;
+	}
+	if (ok) qsort(buckets, bucket_count, sizeof(MphBucket), compare_bucket_size_desc);
+	for (uint32_t bi = 0; ok && bi < bucket_count; ++bi) {
+		MphBucket *bk = &buckets[bi];
+		seeds[bk->bucket] = 1;
+		if (bk->size == 0) continue;
+		int placed = 0;
+		for (uint32_t seed = 1; seed < 1000000 && !placed; ++seed) {
+			placed = 1;
+			for (uint32_t k = 0; k < bk->size; ++k) {
+				uint32_t slot = (uint32_t)(seeded_hash(keys[order[bk->first + k]], seed) % n);
+				int clash = taken[slot];
+				for (uint32_t j = 0; j < k && !clash; ++j) clash = trial[j] == slot;
+				if (clash) { placed = 0; break; }
+				trial[k] = slot;
+			}
+			if (placed) {
+				seeds[bk->bucket] = seed;
+				for (uint32_t k = 0; k < bk->size; ++k) {
+					taken[trial[k]] = 1;
+					slot_of[order[bk->first + k]] = trial[k];
+				}
+			}
+		}
+		if (!placed) ok = 0;
+	}
+	free(buckets);
+	free(order);
+	free(fill);
+	free(taken);
+	return ok;
+}
+
+/* Shared on-disk layout for city-keyed indexes (climatology, gazetteer):
+ *
+ *   CityIndexHeader
+ *   uint32_t seeds[bucket_count]
+ *   uint32_t slot_row[key_count]    row that each perfect-hash slot maps to
+ *   uint32_t slot_key[key_count]    key string offset, to reject unknown cities
+ *   <payload columns, row_count rows each>
+ *   char strings[strings_size]
+ *
+ * Each row is reachable by its "name,cc" key; the first row with a given
+ * name also owns the bare "name" key. */
+typedef struct {
+	char magic[8];
+	uint32_t row_count;
+	uint32_t key_count;
+	uint32_t bucket_count;
+	uint32_t seeds_offset;
+	uint32_t slot_row_offset;
+	uint32_t slot_key_offset;
+	uint32_t payload_offset;
+	uint32_t payload_size;
+	uint32_t strings_offset;
+	uint32_t strings_size;
+} CityIndexHeader;
+
+typedef struct {
+	const char *base;
+	size_t size;
+	int mapped; /* 1: munmap on close, 0: heap image */
+	uint32_t row_count;
+	PerfectHash ph;
+	const uint32_t *slot_row;
+	const uint32_t *slot_key;
+	const char *payload;
+	const char *strings;
+	uint32_t strings_size;
+} CityIndex;
+
+typedef struct {
+	const char *key;
+	uint32_t row;
+	int bare;
+} CityKeyRef;
+
+/* Groups equal keys with the "name,cc" key (if any) first, then by row */
+static int compare_city_key_ref(const void *a, const void *b) {
+	const CityKeyRef *x = (const CityKeyRef *)a, *y = (const CityKeyRef *)b;
+	int c = strcmp(x->key, y->key);
+	if (c) return c;
+	if (x->bare != y->bare) return x->bare - y->bare;
+	return (x->row > y->row) - (x->row < y->row);
+}
+
+/* Writes the key section for rows named by row_keys ("name,cc" each) and
+ * appends payload verbatim. Returns 1 on success */
+static int city_index_build(const char *magic, char **row_keys, uint32_t rows, const MemoryBuffer *payload, MemoryBuffer *image, char *err, size_t errsz) {
+	CityKeyRef *refs = (CityKeyRef *)malloc((size_t)rows * 2 * sizeof(CityKeyRef) + 1);
+	const char **keys = (const char **)malloc((size_t)rows * 2 * sizeof(char *) + 1);
+	uint32_t *key_row = (uint32_t *)malloc((size_t)rows * 2 * sizeof(uint32_t) + 1);
+	char **owned = (char **)calloc((size_t)rows + 1, sizeof(char *));
+	if (!refs || !keys || !key_row || !owned) {
+		free(refs); free(keys); free(key_row); free(owned);
+		snprintf(err, errsz, "out of memory");
+		return 0;
+	}
+	uint32_t nrefs = 0, nkeys = 0;
+	int ok = 1;
+	for (uint32_t r = 0; r < rows; ++r) {
+		refs[nrefs++] = (CityKeyRef){row_keys[r], r, 0};
+		char *comma = strrchr(row_keys[r], ',');
+		if (comma) {
+			owned[r] = strndup(row_keys[r], (size_t)(comma - row_keys[r]));
+			if (owned[r]) refs[nrefs++] = (CityKeyRef){owned[r], r, 1};
+		}
+	}
+	/* Sorting makes duplicates adjacent: two "name,cc" keys are an error,
+	 * and a bare name goes to its first row unless a row is keyed by it */
+	qsort(refs, nrefs, sizeof(CityKeyRef), compare_city_key_ref);
+	for (uint32_t i = 0; i < nrefs && ok; ++i) {
+		if (i > 0 && strcmp(refs[i].key, refs[i - 1].key) == 0) {
+			if (!refs[i].bare) {
+				snprintf(err, errsz, "duplicate city '%s'", refs[i].key);
+				ok = 0;
+			}
+			continue;
+		}
+		keys[nkeys] = refs[i].key;
+		key_row[nkeys++] = refs[i].row;
+	}
+	uint32_t bucket_count = nkeys / 4 + 1;
+	uint32_t *seeds = (uint32_t *)calloc(bucket_count, sizeof(uint32_t));
+	uint32_t *slot_of = (uint32_t *)calloc(nkeys ? nkeys : 1, sizeof(uint32_t));
+	uint32_t *slot_row = (uint32_t *)calloc(nkeys ? nkeys : 1, sizeof(uint32_t));
+	uint32_t *slot_key = (uint32_t *)calloc(nkeys ? nkeys : 1, sizeof(uint32_t));
+	MemoryBuffer strings = {0};
+	if (ok && (!seeds || !slot_of || !slot_row || !slot_key)) {
+		snprintf(err, errsz, "out of memory");
+		ok = 0;
+	}
+	if (ok && (nkeys == 0 || !mph_build(keys, nkeys, bucket_count, seeds, slot_of))) {
+		snprintf(err, errsz, nkeys ? "could not build perfect hash" : "no rows");
+		ok = 0;
+	}
+	for (uint32_t k = 0; ok && k < nkeys; ++k) {
+		slot_row[slot_of[k]] = key_row[k];
+		slot_key[slot_of[k]] = (uint32_t)strings.size;
+		buffer_append(&strings, keys[k], strlen(keys[k]) + 1);
+	}
+	if (ok) {
+		CityIndexHeader hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.magic, magic, sizeof(hdr.magic));
+		hdr.row_count = rows;
+		hdr.key_count = nkeys;
+		hdr.bucket_count = bucket_count;
+		hdr.seeds_offset = (uint32_t)sizeof(hdr);
+		hdr.slot_row_offset = hdr.seeds_offset + bucket_count * 4;
+		hdr.slot_key_offset = hdr.slot_row_offset + nkeys * 4;
+		/* Payload columns start 8-byte aligned so any element type can be read in place */
+		uint32_t payload_pad = (8 - (hdr.slot_key_offset + nkeys * 4) % 8) % 8;
+		hdr.payload_offset = hdr.slot_key_offset + nkeys * 4 + payload_pad;
+		hdr.payload_size = (uint32_t)payload->size;
+		hdr.strings_offset = hdr.payload_offset + hdr.payload_size;
+		hdr.strings_size = (uint32_t)strings.size;
+		static const char zeros[8] = {0};
+		buffer_append(image, (const char *)&hdr, sizeof(hdr));
+		buffer_append(image, (const char *)seeds, (size_t)bucket_count * 4);
+		buffer_append(image, (const char *)slot_row, (size_t)nkeys * 4);
+		buffer_append(image, (const char *)slot_key, (size_t)nkeys * 4);
+		buffer_append(image, zeros, payload_pad);
+		if (payload->size) buffer_append(image, payload->data, payload->size);
+		buffer_append(image, strings.data, strings.size);
+		ok = image->size == (size_t)hdr.strings_offset + hdr.strings_size;
+		if (!ok) snprintf(err, errsz, "out of memory");
+	}
+	for (uint32_t r = 0; r < rows; ++r) free(owned[r]);
+	free(owned);
+	free(refs);
+	free(keys);
+	free(key_row);
+	free(seeds);
+	free(slot_of);
+	free(slot_row);
+	free(slot_key);
+	free(strings.data);
+	return ok;
+}
+
+/* Validates a mapped image; row_bytes is the payload size per row */
+static int city_index_attach(CityIndex *idx, const char *magic, const char *base, size_t size, size_t row_bytes) {
+	memset(idx, 0, sizeof(*idx));
+	if (size < sizeof(CityIndexHeader)) return 0;
+	CityIndexHeader hdr;
+	memcpy(&hdr, base, sizeof(hdr));
+	if (memcmp(hdr.magic, magic, sizeof(hdr.magic)) != 0) return 0;
+	if (hdr.key_count == 0 || hdr.bucket_count == 0) return 0;
+	if (hdr.seeds_offset % 4 || hdr.slot_row_offset % 4 || hdr.slot_key_offset % 4 || hdr.payload_offset % 8) return 0;
+	if ((uint64_t)hdr.seeds_offset + (uint64_t)hdr.bucket_count * 4 > size) return 0;
+	if ((uint64_t)hdr.slot_row_offset + (uint64_t)hdr.key_count * 4 > size) return 0;
+	if ((uint64_t)hdr.slot_key_offset + (uint64_t)hdr.key_count * 4 > size) return 0;
+	if ((uint64_t)hdr.payload_size != (uint64_t)hdr.row_count * row_bytes) return 0;
+	if ((uint64_t)hdr.payload_offset + hdr.payload_size > size) return 0;
+	if ((uint64_t)hdr.strings_offset + hdr.strings_size > size || hdr.strings_size == 0) return 0;
+	if (base[hdr.strings_offset + hdr.strings_size - 1] != '\0') return 0;
+	idx->base = base;
+	idx->size = size;
+	idx->row_count = hdr.row_count;
+	idx->ph.bucket_count = hdr.bucket_count;
+	idx->ph.slot_count = hdr.key_count;
+	idx->ph.seeds = (const uint32_t *)(base + hdr.seeds_offset);
+	idx->slot_row = (const uint32_t *)(base + hdr.slot_row_offset);
+	idx->slot_key = (const uint32_t *)(base + hdr.slot_key_offset);
+	idx->payload = base + hdr.payload_offset;
+	idx->strings = base + hdr.strings_offset;
+	idx->strings_size = hdr.strings_size;
+	for (uint32_t k = 0; k < hdr.key_count; ++k) {
+		if (idx->slot_row[k] >= hdr.row_count || idx->slot_key[k] >= hdr.strings_size) return 0;
+	}
+	return 1;
+}
+
+static int city_index_open(CityIndex *idx, const char *magic, const char *path, size_t row_bytes) {
+	const char *base = NULL;
+	size_t size = 0;
+	if (!map_readonly_file(path, &base, &size)) return 0;
+	if (!city_index_attach(idx, magic, base, size, row_bytes)) {
+		munmap((void *)base, size);
+		memset(idx, 0, sizeof(*idx));
+		return 0;
+	}
+	idx->mapped = 1;
+	return 1;
+}
+
+static void city_index_close(CityIndex *idx) {
+	if (idx->mapped) munmap((void *)idx->base, idx->size);
+	else free((void *)idx->base);
+	memset(idx, 0, sizeof(*idx));
+}
+
+/* Row for a city string ("Austin", "austin, US"...), or -1 if unknown */
+static long city_index_find(const CityIndex *idx, const char *city) {
+	if (!idx->base || !city) return -1;
+	char full[160], name[160];
+	if (!city_keys(city, full, sizeof(full), name, sizeof(name))) return -1;
+	const char *tries[2] = {full, name};
+	for (int t = 0; t < 2; ++t) {
+		if (t == 1 && strcmp(full, name) == 0) break;
+		uint32_t slot = mph_slot(&idx->ph, tries[t]);
+		if (strcmp(idx->strings + idx->slot_key[slot], tries[t]) == 0) return (long)idx->slot_row[slot];
+	}
+	return -1;
+}
+
+/* Splits one comma-separated line in place; returns the field count */
+static int split_csv_line(char *line, char **fields, int max_fields) {
+	int n = 0;
+	char *p = line;
+	while (n < max_fields) {
+		while (*p == ' ' || *p == '\t') p++;
+		fields[n++] = p;
+		char *comma = strchr(p, ',');
+		char *end = comma ? comma : p + strlen(p);
+		while (end > p && isspace((unsigned char)end[-1])) end--;
+		*end = '\0';
+		if (!comma) break;
+		p = comma + 1;
+	}
+	return n;
+}
+
+/* ---------------- Climatology Index ---------------- */
+
+/* Per-city, per-month frequency of each weather type, stored columnar: one
+ * column per WeatherType (except ANY) of row_count x 12 uint16 values in
+ * units of 1/10000, so pick_date reads 12 adjacent values per lookup. */
+#define CLIMATE_MAGIC "DPCLIM1"
+#define CLIMATE_WEATHER_KINDS WEATHER_ANY
+#define CLIMATE_SCALE 10000.0
+
+typedef struct {
+	CityIndex idx;
+} ClimateIndex;
+
+static int climate_open(ClimateIndex *climate, const char *path) {
+	return city_index_open(&climate->idx, CLIMATE_MAGIC, path, CLIMATE_WEATHER_KINDS * 12 * sizeof(uint16_t));
+}
+
+static void climate_close(ClimateIndex *climate) {
+	city_index_close(&climate->idx);
+}
+
+static int climate_has_city(const ClimateIndex *climate, const char *city) {
+	return climate && city_index_find(&climate->idx, city) >= 0;
+}
+
+/* Fills weights[month-1] with the city's frequency of weather. Returns 0 if
+ * the city is unknown or never sees that weather, as no month is then
+ * better than another and the seasonal heuristic should decide */
+static int climate_month_weights(const ClimateIndex *climate, const char *city, WeatherType weather, double weights[12]) {
+	if (!climate || weather == WEATHER_ANY) return 0;
+	long row = city_index_find(&climate->idx, city);
+	if (row < 0) return 0;
+	const uint16_t *column = (const uint16_t *)climate->idx.payload + (size_t)weather * climate->idx.row_count * 12;
+	const uint16_t *months = column + (size_t)row * 12;
+	double total = 0.0;
+	for (int m = 0; m < 12; ++m) {
+		weights[m] = months[m] / CLIMATE_SCALE;
+		total += weights[m];
+	}
+	return total > 0.0;
+}
+
+/* --build-climate: "city,country,weather,jan..dec" rows of fractions in [0,1] */
+/* Builder-side key -> row map: open addressing over row + 1, 0 marks an
+ * empty slot. Rows of one city need not be adjacent in the source. */
+static uint32_t *row_slot(uint32_t *slots, size_t size, char **row_keys, const char *key) {
+	size_t i = (size_t)seeded_hash(key, 0) & (size - 1);
+	while (slots[i] && strcmp(row_keys[slots[i] - 1], key) != 0) i = (i + 1) & (size - 1);
+	return &slots[i];
+}
+
+static int row_slots_grow(uint32_t **slots, size_t *size, char **row_keys, uint32_t rows) {
+	size_t grown = *size ? *size * 2 : 256;
+	uint32_t *table = (uint32_t *)calloc(grown, sizeof(uint32_t));
+	if (!table) return 0;
+	for (uint32_t r = 0; r < rows; ++r) *row_slot(table, grown, row_keys, row_keys[r]) = r + 1;
+	free(*slots);
+	*slots = table;
+	*size = grown;
+	return 1;
+}
+
+static int build_climate_file(const char *src_path, const char *out_path) {
+	char *text = read_text_file(src_path);
+	if (!text) {
+		fprintf(stderr, "Cannot read %s\n", src_path);
+		return 1;
+	}
+	char **row_keys = NULL;
+	uint16_t *values = NULL; /* row-major while reading: [row][kind][month] */
+	uint32_t rows = 0, cap = 0;
+	uint32_t *slots = NULL;
+	size_t slot_count = 0;
+	int ok = 1, line_no = 0;
+	char err[128] = "";
+	for (char *line = text, *next; line && *line && ok; line = next) {
+		next = strchr(line, '\n');
+		if (next) *next++ = '\0';
+		line_no++;
+		char *fields[16];
+		int nf = split_csv_line(line, fields, 16);
+		if (nf == 1 && fields[0][0] == '\0') continue;
+		/* '#' comments and the column header line */
+		if (fields[0][0] == '#' || (nf >= 3 && strcmp(fields[0], "city") == 0 && strcmp(fields[2], "weather") == 0)) continue;
+		if (nf != 15) {
+			snprintf(err, sizeof(err), "line %d: expected city,country,weather,jan..dec", line_no);
+			ok = 0;
+			break;
+		}
+		int kind = lookup_name(weather_names, CLIMATE_WEATHER_KINDS, fields[2], strlen(fields[2]));
+		char joined[160], full[160], name[160];
+		snprintf(joined, sizeof(joined), "%s,%s", fields[0], fields[1]);
+		if (kind < 0 || !city_keys(joined, full, sizeof(full), name, sizeof(name))) {
+			snprintf(err, sizeof(err), "line %d: bad city or weather type", line_no);
+			ok = 0;
+			break;
+		}
+		/* Keep the table at most half full */
+		if ((size_t)(rows + 1) * 2 > slot_count && !row_slots_grow(&slots, &slot_count, row_keys, rows)) {
+			snprintf(err, sizeof(err), "out of memory");
+			ok = 0;
+			break;
+		}
+		uint32_t *slot = row_slot(slots, slot_count, row_keys, full);
+		uint32_t r = *slot ? *slot - 1 : rows;
+		if (r == rows) {
+			if (rows == cap) {
+				cap = cap ? cap * 2 : 64;
+				char **k2 = (char **)realloc(row_keys, cap * sizeof(char *));
+				if (k2) row_keys = k2;
+				uint16_t *v2 = (uint16_t *)realloc(values, (size_t)cap * CLIMATE_WEATHER_KINDS * 12 * sizeof(uint16_t));
+				if (v2) values = v2;
+				if (!k2 || !v2) { snprintf(err, sizeof(err), "out of memory"); ok = 0; break; }
+			}
+			row_keys[rows] = strdup(full);
+			if (!row_keys[rows]) { snprintf(err, sizeof(err), "out of memory"); ok = 0; break; }
+			memset(values + (size_t)rows * CLIMATE_WEATHER_KINDS * 12, 0, CLIMATE_WEATHER_KINDS * 12 * sizeof(uint16_t));
+			*slot = rows + 1;
+			rows++;
+		}
+		for (int m = 0; m < 12; ++m) {
+			double v = atof(fields[3 + m]);
+			if (v < 0.0) v = 0.0;
+			if (v > 1.0) v = 1.0;
+			values[((size_t)r * CLIMATE_WEATHER_KINDS + (size_t)kind) * 12 + (size_t)m] = (uint16_t)(v * CLIMATE_SCALE + 0.5);
+		}
+	}
+	MemoryBuffer payload = {0};
+	MemoryBuffer image = {0};
+	if (ok) {
+		/* Transpose to one contiguous column per weather type */
+		for (int kind = 0; kind < CLIMATE_WEATHER_KINDS; ++kind) {
+			for (uint32_t r = 0; r < rows; ++r) {
+				buffer_append(&payload, (const char *)(values + ((size_t)r * CLIMATE_WEATHER_KINDS + (size_t)kind) * 12), 12 * sizeof(uint16_t));
+			}
+		}
+		ok = city_index_build(CLIMATE_MAGIC, row_keys, rows, &payload, &image, err, sizeof(err));
+	}
+	if (ok && !write_binary_file(out_path, &image)) {
+		snprintf(err, sizeof(err), "cannot write %s", out_path);
+		ok = 0;
+	}
+	if (ok) printf("Wrote %s: %u cities, %zu bytes\n", out_path, rows, image.size);
+	else fprintf(stderr, "%s: %s\n", src_path, err);
+	for (uint32_t r = 0; r < rows; ++r) free(row_keys[r]);
+	free(row_keys);
+	free(slots);
+	free(values);
+	free(payload.data);
+	free(image.data);
+	free(text);
+	return ok ? 0 : 1;
+}
+
+/* ---------------- Offline Gazetteer ---------------- */
+
+/* City -> coordinates, so the hemisphere is known without asking OpenWeather.
+ * Same key layout as the climatology index; the payload is a float latitude
+ * column followed by a float longitude column. */
+#define GAZETTEER_MAGIC "DPGAZ01"
+
+typedef struct {
+	CityIndex idx;
+} Gazetteer;
+
+/* Source format: "city,country,lat,lon" per line, '#' comments. Bare city
+ * names resolve to the first row carrying them, so list larger cities first.
+ * This is the only copy of the default list; --print-builtin gazetteer
+ * writes it out as a starting point for --build-gazetteer. */
+static const char builtin_gazetteer_source[] =
+	"# Offline gazetteer source. Compile with:\n"
+	"#   ./datePicker_app --build-gazetteer cities.csv cities.gaz\n"
+	"# then run with --gazetteer cities.gaz (or DATEPICKER_GAZETTEER=cities.gaz).\n"
+	"# A bare city name resolves to the first row carrying it, so list larger cities first.\n"
+	"# Larger lists can be generated from GeoNames cities*.txt (name, country code, latitude, longitude).\n"
+	"city,country,lat,lon\n"
+	"Tokyo,JP,35.68,139.69\n"
+	"Delhi,IN,28.61,77.21\n"
+	"Shanghai,CN,31.23,121.47\n"
+	"Sao Paulo,BR,-23.55,-46.63\n"
+	"Mexico City,MX,19.43,-99.13\n"
+	"Cairo,EG,30.04,31.24\n"
+	"Mumbai,IN,19.08,72.88\n"
+	"Beijing,CN,39.90,116.41\n"
+	"Dhaka,BD,23.81,90.41\n"
+	"Osaka,JP,34.69,135.50\n"
+	"New York,US,40.71,-74.01\n"
+	"Karachi,PK,24.86,67.01\n"
+	"Buenos Aires,AR,-34.60,-58.38\n"
+	"Istanbul,TR,41.01,28.98\n"
+	"Kolkata,IN,22.57,88.36\n"
+	"Manila,PH,14.60,120.98\n"
+	"Lagos,NG,6.52,3.38\n"
+	"Rio de Janeiro,BR,-22.91,-43.17\n"
+	"Kinshasa,CD,-4.44,15.27\n"
+	"Los Angeles,US,34.05,-118.24\n"
+	"Moscow,RU,55.76,37.62\n"
+	"Lahore,PK,31.55,74.34\n"
+	"Bangalore,IN,12.97,77.59\n"
+	"Paris,FR,48.86,2.35\n"
+	"Bogota,CO,4.71,-74.07\n"
+	"Jakarta,ID,-6.21,106.85\n"
+	"Lima,PE,-12.05,-77.04\n"
+	"Bangkok,TH,13.76,100.50\n"
+	"Seoul,KR,37.57,126.98\n"
+	"Hyderabad,IN,17.39,78.49\n"
+	"London,GB,51.51,-0.13\n"
+	"Tehran,IR,35.69,51.39\n"
+	"Chicago,US,41.88,-87.63\n"
+	"Chennai,IN,13.08,80.27\n"
+	"Ho Chi Minh City,VN,10.82,106.63\n"
+	"Kuala Lumpur,MY,3.14,101.69\n"
+	"Hong Kong,HK,22.32,114.17\n"
+	"Baghdad,IQ,33.32,44.37\n"
+	"Riyadh,SA,24.71,46.68\n"
+	"Santiago,CL,-33.45,-70.67\n"
+	"Madrid,ES,40.42,-3.70\n"
+	"Toronto,CA,43.65,-79.38\n"
+	"Singapore,SG,1.35,103.82\n"
+	"Luanda,AO,-8.84,13.23\n"
+	"Johannesburg,ZA,-26.20,28.05\n"
+	"Houston,US,29.76,-95.37\n"
+	"Dallas,US,32.78,-96.80\n"
+	"Miami,US,25.76,-80.19\n"
+	"Atlanta,US,33.75,-84.39\n"
+	"Philadelphia,US,39.95,-75.17\n"
+	"Washington,US,38.91,-77.04\n"
+	"Boston,US,42.36,-71.06\n"
+	"Phoenix,US,33.45,-112.07\n"
+	"San Francisco,US,37.77,-122.42\n"
+	"Seattle,US,47.61,-122.33\n"
+	"Denver,US,39.74,-104.99\n"
+	"Austin,US,30.27,-97.74\n"
+	"Nairobi,KE,-1.29,36.82\n"
+	"Sydney,AU,-33.87,151.21\n"
+	"Melbourne,AU,-37.81,144.96\n"
+	"Brisbane,AU,-27.47,153.03\n"
+	"Perth,AU,-31.95,115.86\n"
+	"Auckland,NZ,-36.85,174.76\n"
+	"Wellington,NZ,-41.29,174.78\n"
+	"Cape Town,ZA,-33.92,18.42\n"
+	"Berlin,DE,52.52,13.40\n"
+	"Rome,IT,41.90,12.50\n"
+	"Barcelona,ES,41.39,2.17\n"
+	"Lisbon,PT,38.72,-9.14\n"
+	"Amsterdam,NL,52.37,4.90\n"
+	"Vienna,AT,48.21,16.37\n"
+	"Stockholm,SE,59.33,18.07\n"
+	"Oslo,NO,59.91,10.75\n"
+	"Dublin,IE,53.35,-6.26\n"
+	"Athens,GR,37.98,23.73\n"
+	"Warsaw,PL,52.23,21.01\n"
+	"Vancouver,CA,49.28,-123.12\n"
+	"Montreal,CA,45.50,-73.57\n"
+	"London,CA,42.98,-81.25\n"
+	"Dubai,AE,25.20,55.27\n"
+	"Montevideo,UY,-34.90,-56.16\n"
+	"Quito,EC,-0.18,-78.47\n"
+	"Reykjavik,IS,64.15,-21.94\n"
+	"Honolulu,US,21.31,-157.86\n"
+	"Anchorage,US,61.22,-149.90\n";
+
+static int gazetteer_build_image(const char *source, MemoryBuffer *image, char *err, size_t errsz) {
+	char *text = strdup(source);
+	char **row_keys = NULL;
+	float *lats = NULL, *lons = NULL;
+	uint32_t rows = 0, cap = 0;
+	int ok = text != NULL, line_no = 0;
+	if (!ok) snprintf(err, errsz, "out of memory");
+	for (char *line = text, *next; ok && line && *line; line = next) {
+		next = strchr(line, '\n');
+		if (next) *next++ = '\0';
+		line_no++;
+		char *fields[8];
+		int nf = split_csv_line(line, fields, 8);
+		if (nf == 1 && fields[0][0] == '\0') continue;
+		if (fields[0][0] == '#' || (nf >= 3 && strcmp(fields[0], "city") == 0 && strcmp(fields[2], "lat") == 0)) continue;
+		char *lat_end, *lon_end;
+		double lat = nf == 4 ? strtod(fields[2], &lat_end) : 0.0;
+		double lon = nf == 4 ? strtod(fields[3], &lon_end) : 0.0;
+		char joined[160], full[160], name[160];
+		snprintf(joined, sizeof(joined), "%s,%s", fields[0], nf > 1 ? fields[1] : "");
+		if (nf != 4 || *lat_end || *lon_end || lat < -90.0 || lat > 90.0 || lon < -180.0 || lon > 180.0 ||
+			!city_keys(joined, full, sizeof(full), name, sizeof(name))) {
+			snprintf(err, errsz, "line %d: expected city,country,lat,lon", line_no);
+			ok = 0;
+			break;
+		}
+		if (rows == cap) {
+			cap = cap ? cap * 2 : 128;
+			char **k2 = (char **)realloc(row_keys, cap * sizeof(char *));
+			if (k2) row_keys = k2;
+			float *la2 = (float *)realloc(lats, cap * sizeof(float));
+			if (la2) lats = la2;
+			float *lo2 = (float *)realloc(lons, cap * sizeof(float));
+			if (lo2) lons = lo2;
+			if (!k2 || !la2 || !lo2) { snprintf(err, errsz, "out of memory"); ok = 0; break; }
+		}
+		row_keys[rows] = strdup(full);
+		if (!row_keys[rows]) { snprintf(err, errsz, "out of memory"); ok = 0; break; }
+		lats[rows] = (float)lat;
+		lons[rows] = (float)lon;
+		rows++;
+	}
+	MemoryBuffer payload = {0};
+	if (ok && rows) {
+		buffer_append(&payload, (const char *)lats, rows * sizeof(float));
+		buffer_append(&payload, (const char *)lons, rows * sizeof(float));
+	}
+	if (ok) ok = city_index_build(GAZETTEER_MAGIC, row_keys, rows, &payload, image, err, errsz);
+	for (uint32_t r = 0; r < rows; ++r) free(row_keys[r]);
+	free(row_keys);
+	free(lats);
+	free(lons);
+	free(payload.data);
+	free(text);
+	return ok;
+}
+
+static int gazetteer_open(Gazetteer *g, const char *path) {
+	return city_index_open(&g->idx, GAZETTEER_MAGIC, path, 2 * sizeof(float));
+}
+
+static int gazetteer_load_builtin(Gazetteer *g) {
+	memset(g, 0, sizeof(*g));
+	MemoryBuffer image = {0};
+	char err[128];
+	if (!gazetteer_build_image(builtin_gazetteer_source, &image, err, sizeof(err)) ||
+		!city_index_attach(&g->idx, GAZETTEER_MAGIC, image.data, image.size, 2 * sizeof(float))) {
+		free(image.data);
+		memset(g, 0, sizeof(*g));
+		return 0;
+	}
+	return 1;
+}
+
+static void gazetteer_close(Gazetteer *g) {
+	city_index_close(&g->idx);
+}
+
+/* Coordinates for a city string; 0 if the gazetteer does not know it */
+static int gazetteer_lookup(const Gazetteer *g, const char *city, double *lat, double *lon) {
+	long row = city_index_find(&g->idx, city);
+	if (row < 0) return 0;
+	const float *column = (const float *)g->idx.payload;
+	*lat = column[row];
+	*lon = column[g->idx.row_count + (uint32_t)row];
+	return 1;
+}
+
+/* --build-gazetteer: compile "city,country,lat,lon" rows into an index */
+static int build_gazetteer_file(const char *src_path, const char *out_path) {
+	char *source = read_text_file(src_path);
+	if (!source) {
+		fprintf(stderr, "Cannot read %s\n", src_path);
+		return 1;
+	}
+	MemoryBuffer image = {0};
+	char err[128] = "empty source";
+	int ok = gazetteer_build_image(source, &image, err, sizeof(err));
+	free(source);
+	if (!ok) {
+		fprintf(stderr, "%s: %s\n", src_path, err);
+		free(image.data);
+		return 1;
+	}
+	ok = write_binary_file(out_path, &image);
+	if (ok) {
+		CityIndexHeader hdr;
+		memcpy(&hdr, image.data, sizeof(hdr));
+		printf("Wrote %s: %u cities, %zu bytes\n", out_path, hdr.row_count, image.size);
+	} else {
+		fprintf(stderr, "Cannot write %s\n", out_path);
+	}
+	free(image.data);
+	return ok ? 0 : 1;
+}
+
+typedef struct {
+	int year;
+	int month;
+	int day;
+	const char *activity; /* interned in the catalog; valid while it stays open */
+} ActivityOption;
+
+static int generate_activity_options(const ActivityCatalog *catalog, Hemisphere hemi, WeatherType weather, const double *month_weights, ActivityOption *options, int maxOptions) {
+	if (!catalog || !options || maxOptions <= 0) return 0;
+	/* Create activities list based on the season of the picked month for each option */
+	int produced = 0;
+	/* attempt to produce up to maxOptions unique-looking pairs */
+	for (int i = 0; i < maxOptions * 2 && produced < maxOptions; ++i) {
+		int y, m, d;
+		pick_date(hemi, weather, month_weights, &y, &m, &d);
+		Season s = month_to_season(m, hemi);
+		int n = catalog_count(catalog, weather, s);
+		if (n <= 0) continue;
+		const char *idea = catalog_entry(catalog, weather, s, random_next() % n);
+		/* ensure not a duplicate of immediate previous; interned, so pointers compare */
+		int dup = 0;
+		for (int k = 0; k < produced; ++k) {
+			if (options[k].year == y && options[k].month == m && options[k].day == d && options[k].activity == idea) {
+				dup = 1; break;
+			}
+		}
+		if (dup) continue;
+		options[produced].year = y;
+		options[produced].month = m;
+		options[produced].day = d;
+		options[produced].activity = idea;
+		produced++;
+	}
+	return produced;
+}
+
+/* --print-builtin: writes an embedded source to stdout for editing */
+static int print_builtin_source(const char *which) {
+	if (strcmp(which, "catalog") == 0) {
+		fputs(builtin_catalog_source, stdout);
+		return 0;
+	}
+	if (strcmp(which, "gazetteer") == 0) {
+		fputs(builtin_gazetteer_source, stdout);
+		return 0;
+	}
+	fprintf(stderr, "Unknown built-in '%s' (expected catalog or gazetteer)\n", which);
+	return 2;
+}
+
+/* ---------------- Ticketmaster Discovery API Integration ---------------- */
+
+static char *url_encode_component(CURL *curl, const char *s) {
+	if (!s) return NULL;
+	char *escaped = curl_easy_escape(curl, s, 0);
+	if (!escaped) return NULL;
+	/* Caller must free via curl_free */
+	return escaped;
+}
+
+static void format_date_range_utc(int year, int month, int day, char *start_iso, size_t start_sz, char *end_iso, size_t end_sz) {
 	/* Ticketmaster expects ISO8601 with Z. We'll use whole day UTC */
 	snprintf(start_iso, start_sz, "%04d-%02d-%02dT00:00:00Z", year, month, day);
 	snprintf(end_iso, end_sz, "%04d-%02d-%02dT23:59:59Z", year, month, day);
 }
 
-static int fetch_ticketmaster_json(const char *city, const char *api_key, int year, int month, int day, char **out_json) {
-	if (!city || !api_key || !out_json) return 0;
-	CURL *curl = curl_easy_init();
-	if (!curl) return 0;
-	char start_iso[32];
-	char end_iso[32];
-	format_date_range_utc(year, month, day, start_iso, sizeof(start_iso), end_iso, sizeof(end_iso));
-	char *city_enc = url_encode_component(curl, city);
-	char *start_enc = url_encode_component(curl, start_iso);
-	char *end_enc = url_encode_component(curl, end_iso);
-	if (!city_enc || !start_enc || !end_enc) {
-		if (city_enc) curl_free(city_enc);
-		if (start_enc) curl_free(start_enc);
-		if (end_enc) curl_free(end_enc);
-		curl_easy_cleanup(curl);
+static int build_ticketmaster_url(UpstreamClient *client, const char *city, const char *api_key, const char *start_iso, const char *end_iso, const char *extra_params, char *url, size_t urlsz) {
+	CURL *curl = upstream_handle(client);
+	if (!curl) return 0;
+	char *city_enc = url_encode_component(curl, city);
+	char *start_enc = url_encode_component(curl, start_iso);
+	char *end_enc = url_encode_component(curl, end_iso);
+	if (!city_enc || !start_enc || !end_enc) {
+		if (city_enc) curl_free(city_enc);
+		if (start_enc) curl_free(start_enc);
+		if (end_enc) curl_free(end_enc);
+		return 0;
+	}
+	char raw[1280];
+	snprintf(raw, sizeof(raw),
+		"%s/discovery/v2/events.json?apikey=%s&city=%s&startDateTime=%s&endDateTime=%s&%s",
+		client->ticketmaster.base_url, api_key, city_enc, start_enc, end_enc, extra_params);
+	curl_free(city_enc);
+	curl_free(start_enc);
+	curl_free(end_enc);
+	return normalize_url(raw, url, urlsz);
+}
+
+static int ticketmaster_url(UpstreamClient *client, const char *city, const char *api_key, int year, int month, int day, char *url, size_t urlsz) {
+	char start_iso[32];
+	char end_iso[32];
+	format_date_range_utc(year, month, day, start_iso, sizeof(start_iso), end_iso, sizeof(end_iso));
+	return build_ticketmaster_url(client, city, api_key, start_iso, end_iso, "size=10", url, urlsz);
+}
+
+static int fetch_ticketmaster_json(UpstreamClient *client, const Deadline *deadline, const char *url, char **out_json) {
+	if (!client || !deadline || !url || !out_json) return 0;
+	return upstream_get(client, &client->ticketmaster, &client->events_cache, deadline, url, out_json);
+}
+
+/* Locate the '[' of _embedded.events, or NULL when the payload has none */
+static const char *find_ticketmaster_events_array(const char *json) {
+	/* Scope into _embedded { events: [ { name: "..." } ] } */
+	const char *emb = strstr(json, "\"_embedded\"");
+	if (!emb) return NULL;
+	const char *brace = strchr(emb, '{');
+	if (!brace) return NULL;
+	int depth = 1; const char *p = brace + 1;
+	const char *events = NULL;
+	while (*p && depth > 0) {
+		if (*p == '{') depth++;
+		else if (*p == '}') depth--;
+		else if (!events) {
+			const char *ev = strstr(p, "\"events\"");
+			if (ev && ev < strchr(p, '}')) { events = ev; break; }
+		}
+		p++;
+	}
+	if (!events) return NULL;
+	return strchr(events, '[');
+}
+
+/* Returns a pointer just past the JSON object starting at p, honoring strings */
+static const char *skip_json_object(const char *p) {
+	int depth = 0;
+	int in_string = 0;
+	for (; *p; ++p) {
+		if (in_string) {
+			if (*p == '\\' && p[1]) p++;
+			else if (*p == '"') in_string = 0;
+		} else if (*p == '"') {
+			in_string = 1;
+		} else if (*p == '{') {
+			depth++;
+		} else if (*p == '}') {
+			if (--depth == 0) return p + 1;
+		}
+	}
+	return p;
+}
+
+/* Names of the events in _embedded.events. Each event's own name is its
+ * first "name" key; nested venue and classification names are skipped. */
+static int parse_ticketmaster_event_names(const char *json, char names[][128], int max_names) {
+	if (!json || !names || max_names <= 0) return 0;
+	const char *arr = find_ticketmaster_events_array(json);
+	if (!arr) return 0;
+	int count = 0;
+	const char *p = arr + 1;
+	while (count < max_names) {
+		while (*p == ' ' || *p == ',' || *p == '\n' || *p == '\r' || *p == '\t') p++;
+		if (*p != '{') break;
+		const char *end = skip_json_object(p);
+		size_t len = (size_t)(end - p);
+		char *obj = (char *)malloc(len + 1);
+		if (!obj) break;
+		memcpy(obj, p, len);
+		obj[len] = '\0';
+		if (extract_json_string_field(obj, "name", names[count], 128) && names[count][0]) count++;
+		free(obj);
+		p = end;
+	}
+	return count;
+}
+
+/* ---------------- Coalesced Fetch + Parse ---------------- */
+
+#define MAX_EVENT_NAMES 5
+
+typedef struct {
+	char main[64];
+	double lat;
+} WeatherReport;
+
+typedef struct {
+	int count;
+	char names[MAX_EVENT_NAMES][128];
+} EventList;
+
+typedef struct {
+	UpstreamClient *client;
+	const Deadline *deadline;
+	const char *url;
+} FlightFetch;
+
+static int load_weather_report(void *arg, void *out) {
+	FlightFetch *f = (FlightFetch *)arg;
+	WeatherReport *report = (WeatherReport *)out;
+	char *json = NULL;
+	if (!fetch_openweather_json(f->client, f->deadline, f->url, &json)) return 0;
+	memset(report, 0, sizeof(*report));
+	double start = precise_ms();
+	parse_openweather_payload(json, report->main, sizeof(report->main), &report->lat);
+	metrics_record_parse(&f->client->openweather.metrics, (precise_ms() - start) / 1000.0);
+	free(json);
+	return 1;
+}
+
+static int load_event_list(void *arg, void *out) {
+	FlightFetch *f = (FlightFetch *)arg;
+	EventList *events = (EventList *)out;
+	char *json = NULL;
+	if (!fetch_ticketmaster_json(f->client, f->deadline, f->url, &json)) return 0;
+	memset(events, 0, sizeof(*events));
+	double start = precise_ms();
+	events->count = parse_ticketmaster_event_names(json, events->names, MAX_EVENT_NAMES);
+	metrics_record_parse(&f->client->ticketmaster.metrics, (precise_ms() - start) / 1000.0);
+	free(json);
+	return 1;
+}
+
+/* Identical in-flight lookups (same city, or several options on one date)
+ * share a single upstream call and a single parse. */
+static int fetch_weather_report(UpstreamClient *client, const Deadline *deadline, const char *city, const char *api_key, WeatherReport *out) {
+	char url[768];
+	if (!openweather_url(client, city, api_key, url, sizeof(url))) return 0;
+	FlightFetch f = {client, deadline, url};
+	return singleflight_do(&client->flights, url, deadline, load_weather_report, &f, out, sizeof(*out));
+}
+
+static int fetch_event_list(UpstreamClient *client, const Deadline *deadline, const char *city, const char *api_key, int year, int month, int day, EventList *out) {
+	char url[1280];
+	if (!ticketmaster_url(client, city, api_key, year, month, day, url, sizeof(url))) return 0;
+	FlightFetch f = {client, deadline, url};
+	return singleflight_do(&client->flights, url, deadline, load_event_list, &f, out, sizeof(*out));
+}
+
+/* Weather lookup on its own thread, so the caller can prompt or plan while
+ * the request is in flight. Runs inline if the thread cannot be started. */
+typedef struct {
+	UpstreamClient *client;
+	Deadline deadline;
+	const char *city;
+	const char *api_key;
+	WeatherReport report;
+	int ok;
+	int started;
+	pthread_t thread;
+} WeatherTask;
+
+static void *weather_task_main(void *arg) {
+	WeatherTask *t = (WeatherTask *)arg;
+	t->ok = fetch_weather_report(t->client, &t->deadline, t->city, t->api_key, &t->report);
+	upstream_thread_release();
+	return NULL;
+}
+
+static void weather_task_start(WeatherTask *t, UpstreamClient *client, Deadline deadline, const char *city, const char *api_key) {
+	memset(t, 0, sizeof(*t));
+	t->client = client;
+	t->deadline = deadline;
+	t->city = city;
+	t->api_key = api_key;
+	t->started = pthread_create(&t->thread, NULL, weather_task_main, t) == 0;
+	if (!t->started) t->ok = fetch_weather_report(client, &t->deadline, city, api_key, &t->report);
+}
+
+static int weather_task_join(WeatherTask *t) {
+	if (t->started) pthread_join(t->thread, NULL);
+	t->started = 0;
+	return t->ok;
+}
+
+/* ---------------- Ranged Event Index ---------------- */
+
+/* Ticketmaster rejects deep paging past size * page >= 1000 */
+#define RANGE_PAGE_SIZE 200
+#define RANGE_MAX_PAGES 5
+/* Assumed events per day until a ranged response reports the real density */
+#define RANGE_DEFAULT_EVENTS_PER_DAY 5.0
+/* Options beyond this many (more than any caller draws) go per-day */
+#define PLAN_MAX_DATES 12
+
+typedef struct {
+	int date_key; /* yyyymmdd */
+	EventList events;
+} EventDay;
+
+/* Events from one ranged query bucketed by UTC start date (the same day
+ * boundaries per-day queries use), sorted by date.
+ * Dates before covered_before are complete; later dates were cut off by
+ * paging limits and must be fetched individually. */
+typedef struct {
+	EventDay *days;
+	int count;
+	int capacity;
+	int covered_before;
+} EventDayIndex;
+
+static int date_key(int year, int month, int day) {
+	return year * 10000 + month * 100 + day;
+}
+
+/* Days since 1970-01-01 for a yyyymmdd key (proleptic Gregorian) */
+static long date_key_days(int key) {
+	int y = key / 10000, m = (key / 100) % 100, d = key % 100;
+	y -= m <= 2;
+	long era = (y >= 0 ? y : y - 399) / 400;
+	long yoe = y - era * 400;
+	long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+static void event_index_free(EventDayIndex *index) {
+	free(index->days);
+	memset(index, 0, sizeof(*index));
+}
+
+static EventDay *event_index_find(EventDayIndex *index, int key, int create) {
+	int lo = 0, hi = index->count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (index->days[mid].date_key < key) lo = mid + 1;
+		else hi = mid;
+	}
+	if (lo < index->count && index->days[lo].date_key == key) return &index->days[lo];
+	if (!create) return NULL;
+	if (index->count == index->capacity) {
+		int cap = index->capacity ? index->capacity * 2 : 32;
+		EventDay *grown = (EventDay *)realloc(index->days, (size_t)cap * sizeof(EventDay));
+		if (!grown) return NULL;
+		index->days = grown;
+		index->capacity = cap;
+	}
+	memmove(&index->days[lo + 1], &index->days[lo], (size_t)(index->count - lo) * sizeof(EventDay));
+	index->count++;
+	memset(&index->days[lo], 0, sizeof(EventDay));
+	index->days[lo].date_key = key;
+	return &index->days[lo];
+}
+
+/* UTC date of dates.start.dateTime, which is what the startDateTime and
+ * endDateTime filters compare against. Events without a set time carry only
+ * localDate; that is used as is. */
+static int event_start_utc_date(const char *event, int *y, int *m, int *d) {
+	const char *dates = strstr(event, "\"dates\"");
+	const char *start = dates ? strstr(dates, "\"start\"") : NULL;
+	const char *brace = start ? strchr(start, '{') : NULL;
+	if (!brace) return 0;
+	const char *end = skip_json_object(brace);
+	char obj[512];
+	size_t len = (size_t)(end - brace);
+	if (len >= sizeof(obj)) len = sizeof(obj) - 1;
+	memcpy(obj, brace, len);
+	obj[len] = '\0';
+	char value[40];
+	if (extract_json_string_field(obj, "dateTime", value, sizeof(value)) && sscanf(value, "%d-%d-%dT", y, m, d) == 3) return 1;
+	return extract_json_string_field(obj, "localDate", value, sizeof(value)) && sscanf(value, "%d-%d-%d", y, m, d) == 3;
+}
+
+/* Buckets every event of one result page. Sets *total_pages and
+ * *total_events from the page object and *last_key to the latest start date
+ * seen. Returns events seen. */
+static int index_ticketmaster_page(const char *json, EventDayIndex *index, int *total_pages, long *total_events, int *last_key) {
+	*total_pages = 0;
+	*total_events = 0;
+	const char *pg = NULL;
+	for (const char *s = strstr(json, "\"page\""); s; s = strstr(s + 1, "\"page\"")) pg = s;
+	double pages = 0.0;
+	double elements = 0.0;
+	if (pg && extract_json_double_field(pg, "totalPages", &pages)) *total_pages = (int)pages;
+	if (pg && extract_json_double_field(pg, "totalElements", &elements)) *total_events = (long)elements;
+
+	const char *arr = find_ticketmaster_events_array(json);
+	if (!arr) return 0;
+	int seen = 0;
+	const char *p = arr + 1;
+	for (;;) {
+		while (*p == ' ' || *p == ',' || *p == '\n' || *p == '\r' || *p == '\t') p++;
+		if (*p != '{') break;
+		const char *end = skip_json_object(p);
+		size_t len = (size_t)(end - p);
+		char *obj = (char *)malloc(len + 1);
+		if (!obj) break;
+		memcpy(obj, p, len);
+		obj[len] = '\0';
+		char name[128];
+		int y, m, d;
+		if (extract_json_string_field(obj, "name", name, sizeof(name)) && name[0] &&
+			event_start_utc_date(obj, &y, &m, &d)) {
+			int key = date_key(y, m, d);
+			EventDay *day = event_index_find(index, key, 1);
+			if (day && day->events.count < MAX_EVENT_NAMES) {
+				snprintf(day->events.names[day->events.count], sizeof(day->events.names[0]), "%s", name);
+				day->events.count++;
+			}
+			if (key > *last_key) *last_key = key;
+			seen++;
+		}
+		free(obj);
+		p = end;
+	}
+	return seen;
+}
+
+/* URL of one result page of the ranged query over [start_key, end_key] */
+static int ranged_page_url(UpstreamClient *client, const char *city, const char *api_key, int start_key, int end_key, int page, char *url, size_t urlsz) {
+	char start_iso[32];
+	char end_iso[32];
+	char extra[96];
+	snprintf(start_iso, sizeof(start_iso), "%04d-%02d-%02dT00:00:00Z", start_key / 10000, (start_key / 100) % 100, start_key % 100);
+	snprintf(end_iso, sizeof(end_iso), "%04d-%02d-%02dT23:59:59Z", end_key / 10000, (end_key / 100) % 100, end_key % 100);
+	snprintf(extra, sizeof(extra), "size=%d&page=%d&sort=date,asc", RANGE_PAGE_SIZE, page);
+	return build_ticketmaster_url(client, city, api_key, start_iso, end_iso, extra, url, urlsz);
+}
+
+typedef struct {
+	int lo; /* date keys */
+	int hi;
+	int dates; /* distinct option dates in [lo, hi] */
+} EventRange;
+
+/* Ranged pages needed for [lo, hi] at the given density */
+static int range_pages(int lo, int hi, double events_per_day) {
+	double events = (double)(date_key_days(hi) - date_key_days(lo) + 1) * events_per_day;
+	int pages = (int)((events + RANGE_PAGE_SIZE - 1) / RANGE_PAGE_SIZE);
+	return pages < 1 ? 1 : pages;
+}
+
+/* Splits the distinct option dates into the groups that take the fewest
+ * requests: a lone date costs one per-day call, a group of nearby dates the
+ * ranged pages its span needs at events_per_day. A group is only formed when
+ * it is strictly cheaper than per-day calls and fits the paging cap.
+ * Returns the number of ranges, earliest first. */
+static int plan_event_ranges(const ActivityOption *options, int count, double events_per_day, EventRange *ranges) {
+	int keys[PLAN_MAX_DATES];
+	int n = 0;
+	for (int i = 0; i < count && n < PLAN_MAX_DATES; ++i) {
+		int key = date_key(options[i].year, options[i].month, options[i].day);
+		int j = n;
+		while (j > 0 && keys[j - 1] > key) {
+			keys[j] = keys[j - 1];
+			j--;
+		}
+		if (j > 0 && keys[j - 1] == key) {
+			memmove(&keys[j], &keys[j + 1], (size_t)(n - j) * sizeof(int));
+			continue;
+		}
+		keys[j] = key;
+		n++;
+	}
+	/* cost[j] = fewest requests for the first j dates; from[j] = where the last group starts */
+	int cost[PLAN_MAX_DATES + 1];
+	int from[PLAN_MAX_DATES + 1];
+	cost[0] = 0;
+	for (int j = 1; j <= n; ++j) {
+		cost[j] = cost[j - 1] + 1;
+		from[j] = j - 1;
+		for (int i = j - 2; i >= 0; --i) {
+			int pages = range_pages(keys[i], keys[j - 1], events_per_day);
+			if (pages > RANGE_MAX_PAGES || pages >= j - i) continue;
+			if (cost[i] + pages < cost[j]) {
+				cost[j] = cost[i] + pages;
+				from[j] = i;
+			}
+		}
+	}
+	int nranges = 0;
+	for (int j = n; j > 0; j = from[j]) nranges++;
+	int r = nranges;
+	for (int j = n; j > 0; j = from[j]) {
+		r--;
+		ranges[r].lo = keys[from[j]];
+		ranges[r].hi = keys[j - 1];
+		ranges[r].dates = j - from[j];
+	}
+	return nranges;
+}
+
+/* Planning density: what ranged responses reported so far, else a guess */
+static double ranged_events_per_day(UpstreamClient *client) {
+	long milli = atomic_load(&client->events_per_day_milli);
+	return milli > 0 ? (double)milli / 1000.0 : RANGE_DEFAULT_EVENTS_PER_DAY;
+}
+
+/* Raw page fetch shared like fetch_event_list: one caller claims the url and
+ * fills the events cache, concurrent ones wait and then read it from there */
+static int fetch_ticketmaster_page(UpstreamClient *client, const Deadline *deadline, const char *url, char **out_json) {
+	/* A few rounds cover a failed leader; past that (or out of memory) fetch unshared */
+	for (int round = 0; round < 3; ++round) {
+		FlightCall *call = singleflight_claim(&client->flights, url);
+		if (call) {
+			int ok = fetch_ticketmaster_json(client, deadline, url, out_json);
+			singleflight_handoff(&client->flights, call);
+			return ok;
+		}
+		if (!singleflight_await(&client->flights, url, deadline)) return 0;
+	}
+	return fetch_ticketmaster_json(client, deadline, url, out_json);
+}
+
+/* One paged query spanning [start, end] instead of one request per day.
+ * Stops once the pages still needed would cost more than the per-day calls
+ * they replace (max_pages, at most one per option date in the range). */
+static int fetch_event_index(UpstreamClient *client, const Deadline *deadline, const char *city, const char *api_key, int start_key, int end_key, int max_pages, EventDayIndex *index) {
+	memset(index, 0, sizeof(*index));
+	int last_key = 0;
+	if (max_pages > RANGE_MAX_PAGES) max_pages = RANGE_MAX_PAGES;
+	for (int page = 0; page < max_pages; ++page) {
+		char url[1280];
+		char *json = NULL;
+		if (!ranged_page_url(client, city, api_key, start_key, end_key, page, url, sizeof(url)) ||
+			!fetch_ticketmaster_page(client, deadline, url, &json)) {
+			/* Keep what earlier pages covered; later dates fall back to per-day calls */
+			index->covered_before = page > 0 ? last_key : 0;
+			return page > 0;
+		}
+		int total_pages = 0;
+		long total_events = 0;
+		double parse_start = precise_ms();
+		index_ticketmaster_page(json, index, &total_pages, &total_events, &last_key);
+		metrics_record_parse(&client->ticketmaster.metrics, (precise_ms() - parse_start) / 1000.0);
+		free(json);
+		if (page == 0) {
+			/* Moving average, so one unusually busy or quiet city does not swing plans */
+			double observed = (double)total_events / (double)(date_key_days(end_key) - date_key_days(start_key) + 1);
+			long seen = atomic_load(&client->events_per_day_milli);
+			long milli = (long)(observed * 1000.0 + 0.5);
+			atomic_store(&client->events_per_day_milli, seen > 0 ? (seen * 3 + milli) / 4 : (milli > 0 ? milli : 1));
+		}
+		if (page + 1 >= total_pages) {
+			index->covered_before = end_key + 1;
+			return 1;
+		}
+		if (total_pages > max_pages) break;
+	}
+	/* Results are date-sorted, so only the last seen date may be partial */
+	index->covered_before = last_key;
+	return 1;
+}
+
+/* Fills events[i] / ok[i] for every option: one call per option, or in
+ * ranged mode one paged query per cluster of nearby dates, bucketed locally,
+ * with per-day calls for lone dates and for anything the pages did not fully
+ * cover. */
+static void fetch_option_events(UpstreamClient *client, const Deadline *deadline, const char *city, const char *api_key, int ranged,
+	const ActivityOption *options, int count, EventList *events, int *ok) {
+	int done[PLAN_MAX_DATES] = {0};
+	int planned = count < PLAN_MAX_DATES ? count : PLAN_MAX_DATES;
+	EventRange ranges[PLAN_MAX_DATES];
+	int nranges = ranged ? plan_event_ranges(options, planned, ranged_events_per_day(client), ranges) : 0;
+	for (int r = 0; r < nranges; ++r) {
+		if (ranges[r].dates < 2) continue;
+		EventDayIndex index;
+		fetch_event_index(client, deadline, city, api_key, ranges[r].lo, ranges[r].hi, ranges[r].dates, &index);
+		for (int i = 0; i < planned; ++i) {
+			int key = date_key(options[i].year, options[i].month, options[i].day);
+			if (key < ranges[r].lo || key > ranges[r].hi || key >= index.covered_before) continue;
+			EventDay *day = event_index_find(&index, key, 0);
+			if (day) events[i] = day->events;
+			else events[i].count = 0;
+			ok[i] = 1;
+			done[i] = 1;
+		}
+		event_index_free(&index);
+	}
+	for (int i = 0; i < count; ++i) {
+		if (i < planned && done[i]) continue;
+		ok[i] = fetch_event_list(client, deadline, city, api_key, options[i].year, options[i].month, options[i].day, &events[i]);
+	}
+}
+
+/* ---------------- Speculative Event Prefetch ---------------- */
+
+/* Before the weather is known, options are drawn for each of the most likely
+ * weather types and their event requests run next to the weather request on
+ * one multi handle. When the weather arrives the matching plan becomes the
+ * answer; requests only other plans needed are cancelled, and finished ones
+ * sit in the events cache for fetch_option_events to pick up. */
+#define PREFETCH_MAX_OPTIONS 12
+#define PREFETCH_MAX_PLANS CLIMATE_WEATHER_KINDS
+#define PREFETCH_MAX_TRANSFERS (PREFETCH_MAX_PLANS * PREFETCH_MAX_OPTIONS + 1)
+#define PREFETCH_MAX_HOST_CONNECTIONS 8
+
+typedef struct {
+	WeatherType weather;
+	int count;
+	ActivityOption options[PREFETCH_MAX_OPTIONS];
+} OptionPlan;
+
+typedef struct {
+	CURL *easy;
+	UpstreamEndpoint *endpoint;
+	ResponseCache *cache;
+	char url[1280];
+	MemoryBuffer body;
+	unsigned plans; /* bit per OptionPlan that needs this response; 0 for weather */
+	int running;
+	int probe; /* holds the endpoint's half-open probe */
+	FlightCall *flight; /* claim on url, so concurrent callers wait for this transfer */
+} PrefetchTransfer;
+
+/* Fills out with up to max concrete weather types, most likely this month
+ * first: the city's climatology when indexed, else the seasonal heuristic */
+static int likely_weather_types(const ClimateIndex *climate, const char *city, Hemisphere hemi, WeatherType *out, int max) {
+	time_t now = time(NULL);
+	struct tm lt;
+	localtime_r(&now, &lt);
+	int month = lt.tm_mon + 1;
+	double score[CLIMATE_WEATHER_KINDS];
+	int taken[CLIMATE_WEATHER_KINDS] = {0};
+	int indexed = climate_has_city(climate, city);
+	for (int w = 0; w < CLIMATE_WEATHER_KINDS; ++w) {
+		double weights[12];
+		if (climate_month_weights(climate, city, (WeatherType)w, weights)) score[w] = weights[month - 1];
+		else if (indexed) score[w] = 0.0; /* indexed but never observed */
+		else score[w] = season_affinity((WeatherType)w, month_to_season(month, hemi));
+	}
+	if (max > CLIMATE_WEATHER_KINDS) max = CLIMATE_WEATHER_KINDS;
+	for (int k = 0; k < max; ++k) {
+		int best = -1;
+		for (int w = 0; w < CLIMATE_WEATHER_KINDS; ++w) {
+			if (!taken[w] && (best < 0 || score[w] > score[best])) best = w;
+		}
+		taken[best] = 1;
+		out[k] = (WeatherType)best;
+	}
+	return max;
+}
+
+/* Adds url for plan, sharing the transfer when another plan asked for it.
+ * New transfers stop at max_transfers, weather included */
+static void prefetch_add(PrefetchTransfer *ts, int *n, int max_transfers, UpstreamClient *client, const char *url, int plan) {
+	for (int i = 1; i < *n; ++i) {
+		if (strcmp(ts[i].url, url) == 0) {
+			ts[i].plans |= 1u << plan;
+			return;
+		}
+	}
+	if (*n >= max_transfers || *n >= PREFETCH_MAX_TRANSFERS) return;
+	PrefetchTransfer *t = &ts[(*n)++];
+	t->endpoint = &client->ticketmaster;
+	t->cache = &client->events_cache;
+	snprintf(t->url, sizeof(t->url), "%s", url);
+	t->plans = 1u << plan;
+}
+
+/* Ends t's claim on its url, waking callers that waited on it */
+static void prefetch_unclaim(UpstreamClient *client, PrefetchTransfer *t) {
+	if (t->flight) singleflight_handoff(&client->flights, t->flight);
+	t->flight = NULL;
+}
+
+/* Queues t on multi unless the cache already holds it, another caller is
+ * already fetching it, or the breaker is open */
+static void prefetch_start(UpstreamClient *client, CURLM *multi, PrefetchTransfer *t, const Deadline *deadline) {
+	char *cached = cache_get(t->cache, t->url, NULL);
+	if (cached) {
+		free(cached);
+		return;
+	}
+	long remaining = deadline_remaining_ms(deadline);
+	if (remaining <= 0) return;
+	t->flight = singleflight_claim(&client->flights, t->url);
+	if (!t->flight) return;
+	t->easy = curl_easy_init();
+	if (!t->easy) {
+		prefetch_unclaim(client, t);
+		return;
+	}
+	int allowed = breaker_allow(&t->endpoint->breaker);
+	if (!allowed) {
+		curl_easy_cleanup(t->easy);
+		t->easy = NULL;
+		prefetch_unclaim(client, t);
+		return;
+	}
+	t->probe = allowed == 2;
+	long timeout = remaining < client->retry.attempt_timeout_ms ? remaining : client->retry.attempt_timeout_ms;
+	long connect_timeout = timeout < client->retry.connect_timeout_ms ? timeout : client->retry.connect_timeout_ms;
+	curl_easy_setopt(t->easy, CURLOPT_SHARE, client->share);
+	curl_easy_setopt(t->easy, CURLOPT_URL, t->url);
+	curl_easy_setopt(t->easy, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(t->easy, CURLOPT_TIMEOUT_MS, timeout);
+	curl_easy_setopt(t->easy, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout);
+	curl_easy_setopt(t->easy, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, write_memory_callback);
+	curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, (void *)&t->body);
+	curl_easy_setopt(t->easy, CURLOPT_PRIVATE, (void *)t);
+	if (curl_multi_add_handle(multi, t->easy) != CURLM_OK) {
+		curl_easy_cleanup(t->easy);
+		t->easy = NULL;
+		if (t->probe) breaker_release(&t->endpoint->breaker);
+		t->probe = 0;
+		prefetch_unclaim(client, t);
+		return;
+	}
+	atomic_fetch_add(&t->endpoint->requests, 1);
+	t->running = 1;
+}
+
+static void prefetch_release(UpstreamClient *client, CURLM *multi, PrefetchTransfer *t) {
+	curl_multi_remove_handle(multi, t->easy);
+	curl_easy_cleanup(t->easy);
+	t->easy = NULL;
+	free(t->body.data);
+	memset(&t->body, 0, sizeof(t->body));
+	t->running = 0;
+	prefetch_unclaim(client, t);
+}
+
+/* Single attempt: success lands in the cache; failures are left to the
+ * regular retrying path, which will miss the cache and try again */
+static void prefetch_done(UpstreamClient *client, CURLM *multi, PrefetchTransfer *t, CURLcode res) {
+	long http_code = 0;
+	curl_easy_getinfo(t->easy, CURLINFO_RESPONSE_CODE, &http_code);
+	metrics_record_attempt(&t->endpoint->metrics, t->easy, res, http_code, t->body.size);
+	metrics_record_call(&t->endpoint->metrics, 1, OUTCOME_OK);
+	int ok = res == CURLE_OK && http_code >= 200 && http_code < 300 && t->body.data && t->body.size > 0;
+	breaker_record(&t->endpoint->breaker, t->probe, ok || (res == CURLE_OK && http_code < 500));
+	t->probe = 0;
+	if (ok) cache_put(t->cache, t->url, t->body.data, 1);
+	prefetch_release(client, multi, t);
+}
+
+/* A cancelled transfer says nothing about the upstream, so any probe it
+ * held goes back rather than into breaker_record */
+static void prefetch_cancel(UpstreamClient *client, CURLM *multi, PrefetchTransfer *t) {
+	metrics_record_call(&t->endpoint->metrics, 0, OUTCOME_CANCELLED);
+	if (t->probe) breaker_release(&t->endpoint->breaker);
+	t->probe = 0;
+	prefetch_release(client, multi, t);
+}
+
+/* Fetches the weather report while prefetching the plans' events, likeliest
+ * plan first, with at most max_events speculative event requests (the
+ * option count asked for, so prefetch at most doubles a request's cost).
+ * Sets *chosen to the plan drawn for the reported weather type, or -1 when
+ * the weather matched none of them. Returns 1 when the weather report is known */
+static int prefetch_weather_and_events(UpstreamClient *client, const Deadline *deadline, const char *city, const char *weather_key,
+	const char *events_key, int ranged, const OptionPlan *plans, int nplans, int max_events, WeatherReport *report, int *chosen) {
+	*chosen = -1;
+	PrefetchTransfer *ts = (PrefetchTransfer *)calloc(PREFETCH_MAX_TRANSFERS, sizeof(PrefetchTransfer));
+	CURLM *multi = upstream_multi();
+	if (!ts || !multi || !openweather_url(client, city, weather_key, ts[0].url, sizeof(ts[0].url))) {
+		free(ts);
+		int ok = fetch_weather_report(client, deadline, city, weather_key, report);
+		for (int p = 0; ok && p < nplans; ++p) {
+			if (plans[p].weather == map_openweather_main_to_type(report->main)) *chosen = p;
+		}
+		return ok;
+	}
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)PREFETCH_MAX_HOST_CONNECTIONS);
+	ts[0].endpoint = &client->openweather;
+	ts[0].cache = &client->weather_cache;
+	int n = 1;
+	for (int p = 0; p < nplans; ++p) {
+		char url[1280];
+		if (plans[p].count <= 0) continue;
+		/* fetch_option_events asks for exactly these: each cluster's first
+		 * ranged page, and per-day calls for lone dates */
+		EventRange ranges[PLAN_MAX_DATES];
+		int nranges = ranged ? plan_event_ranges(plans[p].options, plans[p].count, ranged_events_per_day(client), ranges) : 0;
+		for (int r = 0; r < nranges; ++r) {
+			if (ranges[r].dates >= 2 && ranged_page_url(client, city, events_key, ranges[r].lo, ranges[r].hi, 0, url, sizeof(url))) prefetch_add(ts, &n, max_events + 1, client, url, p);
+		}
+		for (int i = 0; i < plans[p].count; ++i) {
+			const ActivityOption *o = &plans[p].options[i];
+			int key = date_key(o->year, o->month, o->day);
+			int clustered = 0;
+			for (int r = 0; r < nranges; ++r) {
+				if (ranges[r].dates >= 2 && key >= ranges[r].lo && key <= ranges[r].hi) clustered = 1;
+			}
+			if (!clustered && ticketmaster_url(client, city, events_key, o->year, o->month, o->day, url, sizeof(url))) prefetch_add(ts, &n, max_events + 1, client, url, p);
+		}
+	}
+	/* Weather first so it gets the first connection */
+	for (int i = 0; i < n; ++i) prefetch_start(client, multi, &ts[i], deadline);
+
+	int decided = 0;
+	int weather_ok = 0;
+	for (;;) {
+		int still = 0;
+		curl_multi_perform(multi, &still);
+		CURLMsg *msg;
+		int queued;
+		while ((msg = curl_multi_info_read(multi, &queued)) != NULL) {
+			if (msg->msg != CURLMSG_DONE) continue;
+			PrefetchTransfer *t = NULL;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&t);
+			if (t) prefetch_done(client, multi, t, msg->data.result);
+		}
+		if (!decided && !ts[0].running) {
+			/* Served from the cache just filled, shared with another caller already
+			 * fetching it, or retried here if the single attempt failed */
+			decided = 1;
+			weather_ok = fetch_weather_report(client, deadline, city, weather_key, report);
+			WeatherType weather = weather_ok ? map_openweather_main_to_type(report->main) : WEATHER_ANY;
+			for (int p = 0; weather_ok && p < nplans; ++p) {
+				if (plans[p].weather == weather) *chosen = p;
+			}
+			unsigned keep = *chosen >= 0 ? 1u << *chosen : 0u;
+			for (int i = 1; i < n; ++i) {
+				if (ts[i].running && !(ts[i].plans & keep)) prefetch_cancel(client, multi, &ts[i]);
+			}
+		}
+		int running = 0;
+		for (int i = 0; i < n; ++i) running += ts[i].running;
+		if (decided && running == 0) break;
+		long remaining = deadline_remaining_ms(deadline);
+		if (remaining <= 0) {
+			for (int i = 0; i < n; ++i) {
+				if (ts[i].running) prefetch_cancel(client, multi, &ts[i]);
+			}
+			break;
+		}
+		curl_multi_poll(multi, NULL, 0, (int)(remaining < 1000 ? remaining : 1000), NULL);
+	}
+	free(ts);
+	return weather_ok;
+}
+
+/* ---------------- Metrics Export ---------------- */
+
+static void prom_histogram(MemoryBuffer *out, const char *metric, const char *labels, const Histogram *h) {
+	unsigned long acc = 0;
+	for (int i = 0; i < h->nbounds; ++i) {
+		acc += h->counts[i];
+		buffer_appendf(out, "%s_bucket{%s,le=\"%g\"} %lu\n", metric, labels, h->bounds[i], acc);
+	}
+	acc += h->counts[h->nbounds];
+	buffer_appendf(out, "%s_bucket{%s,le=\"+Inf\"} %lu\n", metric, labels, acc);
+	buffer_appendf(out, "%s_sum{%s} %.9g\n", metric, labels, h->sum);
+	buffer_appendf(out, "%s_count{%s} %lu\n", metric, labels, h->count);
+}
+
+static void metrics_write_prometheus(UpstreamClient *client, MemoryBuffer *out) {
+	UpstreamEndpoint *endpoints[2] = {&client->openweather, &client->ticketmaster};
+	buffer_appendf(out, "# HELP datepicker_upstream_phase_seconds Per-attempt transfer phase durations.\n");
+	buffer_appendf(out, "# TYPE datepicker_upstream_phase_seconds histogram\n");
+	for (int e = 0; e < 2; ++e) {
+		EndpointMetrics *m = &endpoints[e]->metrics;
+		pthread_mutex_lock(&m->lock);
+		for (int p = 0; p < PHASE_COUNT; ++p) {
+			char labels[96];
+			snprintf(labels, sizeof(labels), "endpoint=\"%s\",phase=\"%s\"", endpoints[e]->name, phase_names[p]);
+			prom_histogram(out, "datepicker_upstream_phase_seconds", labels, &m->phases[p]);
+		}
+		pthread_mutex_unlock(&m->lock);
+	}
+	struct { const char *metric; const char *help; size_t offset; } hists[] = {
+		{"datepicker_upstream_response_bytes", "Response body sizes.", offsetof(EndpointMetrics, response_bytes)},
+		{"datepicker_upstream_attempts", "Attempts per upstream call that missed the cache.", offsetof(EndpointMetrics, attempts)},
+		{"datepicker_upstream_parse_seconds", "Time spent parsing upstream payloads.", offsetof(EndpointMetrics, parse_seconds)},
+	};
+	for (size_t k = 0; k < sizeof(hists) / sizeof(hists[0]); ++k) {
+		buffer_appendf(out, "# HELP %s %s\n# TYPE %s histogram\n", hists[k].metric, hists[k].help, hists[k].metric);
+		for (int e = 0; e < 2; ++e) {
+			EndpointMetrics *m = &endpoints[e]->metrics;
+			char labels[64];
+			snprintf(labels, sizeof(labels), "endpoint=\"%s\"", endpoints[e]->name);
+			pthread_mutex_lock(&m->lock);
+			prom_histogram(out, hists[k].metric, labels, (const Histogram *)((const char *)m + hists[k].offset));
+			pthread_mutex_unlock(&m->lock);
+		}
+	}
+	buffer_appendf(out, "# HELP datepicker_upstream_outcomes_total Attempt results and calls rejected before sending.\n");
+	buffer_appendf(out, "# TYPE datepicker_upstream_outcomes_total counter\n");
+	for (int e = 0; e < 2; ++e) {
+		EndpointMetrics *m = &endpoints[e]->metrics;
+		pthread_mutex_lock(&m->lock);
+		for (int o = 0; o < OUTCOME_COUNT; ++o) {
+			buffer_appendf(out, "datepicker_upstream_outcomes_total{endpoint=\"%s\",outcome=\"%s\"} %lu\n",
+				endpoints[e]->name, outcome_names[o], m->outcomes[o]);
+		}
+		pthread_mutex_unlock(&m->lock);
+	}
+	buffer_appendf(out, "# HELP datepicker_upstream_cache_hits_total Calls answered from the response cache.\n");
+	buffer_appendf(out, "# TYPE datepicker_upstream_cache_hits_total counter\n");
+	for (int e = 0; e < 2; ++e) {
+		EndpointMetrics *m = &endpoints[e]->metrics;
+		pthread_mutex_lock(&m->lock);
+		buffer_appendf(out, "datepicker_upstream_cache_hits_total{endpoint=\"%s\"} %lu\n", endpoints[e]->name, m->cache_hits);
+		pthread_mutex_unlock(&m->lock);
+	}
+	buffer_appendf(out, "# HELP datepicker_upstream_prefetch_hits_total Calls answered by a response prefetched for them.\n");
+	buffer_appendf(out, "# TYPE datepicker_upstream_prefetch_hits_total counter\n");
+	for (int e = 0; e < 2; ++e) {
+		EndpointMetrics *m = &endpoints[e]->metrics;
+		pthread_mutex_lock(&m->lock);
+		buffer_appendf(out, "datepicker_upstream_prefetch_hits_total{endpoint=\"%s\"} %lu\n", endpoints[e]->name, m->prefetch_hits);
+		pthread_mutex_unlock(&m->lock);
+	}
+}
+
+static void json_histogram_summary(MemoryBuffer *out, const char *name, const Histogram *h, int first) {
+	buffer_appendf(out, "%s\"%s\":{\"count\":%lu,\"sum\":%.9g,\"mean\":%.9g,\"p50\":%.9g,\"p90\":%.9g,\"p99\":%.9g,\"max\":%.9g}",
+		first ? "" : ",", name, h->count, h->sum, h->count ? h->sum / (double)h->count : 0.0,
+		histogram_quantile(h, 0.50), histogram_quantile(h, 0.90), histogram_quantile(h, 0.99), h->max);
+}
+
+/* Compact summary; quantiles are interpolated within buckets, so they are
+ * estimates bounded by the bucket edges rather than exact values */
+static void metrics_write_json(UpstreamClient *client, MemoryBuffer *out) {
+	UpstreamEndpoint *endpoints[2] = {&client->openweather, &client->ticketmaster};
+	buffer_append(out, "{", 1);
+	for (int e = 0; e < 2; ++e) {
+		EndpointMetrics *m = &endpoints[e]->metrics;
+		pthread_mutex_lock(&m->lock);
+		buffer_appendf(out, "%s\"%s\":{\"phases_seconds\":{", e ? "," : "", endpoints[e]->name);
+		for (int p = 0; p < PHASE_COUNT; ++p) json_histogram_summary(out, phase_names[p], &m->phases[p], p == 0);
+		buffer_append(out, "}", 1);
+		json_histogram_summary(out, "response_bytes", &m->response_bytes, 0);
+		json_histogram_summary(out, "attempts", &m->attempts, 0);
+		json_histogram_summary(out, "parse_seconds", &m->parse_seconds, 0);
+		buffer_appendf(out, ",\"outcomes\":{");
+		for (int o = 0; o < OUTCOME_COUNT; ++o) buffer_appendf(out, "%s\"%s\":%lu", o ? "," : "", outcome_names[o], m->outcomes[o]);
+		buffer_appendf(out, "},\"cache_hits\":%lu,\"prefetch_hits\":%lu}", m->cache_hits, m->prefetch_hits);
+		pthread_mutex_unlock(&m->lock);
+	}
+	buffer_append(out, "}\n", 2);
+}
+
+/* ---------------- Run Options ---------------- */
+
+typedef struct {
+	int serve_port;
+	int workers;
+	int ranged_events;
+	int bench_iterations;
+	char bench_city[128];
+	const char *metrics_format; /* "prom" or "json"; NULL disables the exit dump */
+	const char *metrics_out;    /* file path; stderr when NULL */
+	const char *catalog_path;   /* compiled activity catalog; built-in when NULL */
+	const char *climate_path;   /* compiled climatology index; seasonal heuristic when NULL */
+	const char *gazetteer_path; /* compiled gazetteer; built-in city list when NULL */
+	int prefetch_types;         /* likely weather types to prefetch events for; 0 disables */
+} AppOptions;
+
+/* Read-only data sets loaded once and shared by every request */
+typedef struct {
+	ActivityCatalog catalog;
+	ClimateIndex climate;
+	Gazetteer gazetteer;
+} AppData;
+
+static int app_data_load(AppData *data, const AppOptions *opts) {
+	memset(data, 0, sizeof(*data));
+	if (opts->catalog_path) {
+		if (!catalog_open(&data->catalog, opts->catalog_path)) {
+			fprintf(stderr, "Cannot load activity catalog %s\n", opts->catalog_path);
+			return 0;
+		}
+	} else if (!catalog_load_builtin(&data->catalog)) {
+		fprintf(stderr, "Cannot build the built-in activity catalog\n");
 		return 0;
 	}
-	char url[1024];
-	snprintf(url, sizeof(url),
-		"https://app.ticketmaster.com/discovery/v2/events.json?apikey=%s&city=%s&startDateTime=%s&endDateTime=%s&size=10",
-		api_key, city_enc, start_enc, end_enc);
-	curl_free(city_enc);
-	curl_free(start_enc);
-	curl_free(end_enc);
+	if (opts->climate_path && !climate_open(&data->climate, opts->climate_path)) {
+		fprintf(stderr, "Cannot load climatology index %s\n", opts->climate_path);
+		catalog_close(&data->catalog);
+		return 0;
+	}
+	int gazetteer_ok = opts->gazetteer_path ? gazetteer_open(&data->gazetteer, opts->gazetteer_path) : gazetteer_load_builtin(&data->gazetteer);
+	if (!gazetteer_ok) {
+		if (opts->gazetteer_path) fprintf(stderr, "Cannot load gazetteer %s\n", opts->gazetteer_path);
+		else fprintf(stderr, "Cannot build the built-in gazetteer\n");
+		catalog_close(&data->catalog);
+		climate_close(&data->climate);
+		return 0;
+	}
+	return 1;
+}
 
-	int attempts = 0;
-	while (attempts < 3) {
-		attempts++;
-		MemoryBuffer chunk = {0};
-		curl_easy_setopt(curl, CURLOPT_URL, url);
-		curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-		curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
-		curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-		CURLcode res = curl_easy_perform(curl);
-		long http_code = 0;
-		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-		if (res == CURLE_OK && http_code >= 200 && http_code < 300 && chunk.data && chunk.size > 0) {
-			*out_json = chunk.data;
-			curl_easy_cleanup(curl);
+static void app_data_free(AppData *data) {
+	catalog_close(&data->catalog);
+	climate_close(&data->climate);
+	gazetteer_close(&data->gazetteer);
+}
+
+/* Hemisphere from the offline gazetteer; 0 if the city is not listed */
+static int city_hemisphere(const AppData *data, const char *city, Hemisphere *out) {
+	double lat, lon;
+	if (!gazetteer_lookup(&data->gazetteer, city, &lat, &lon)) return 0;
+	*out = hemisphere_from_lat(lat);
+	return 1;
+}
+
+/* Month weights for pick_date: buf filled from the climatology index, or NULL
+ * to fall back to the seasonal heuristic for unknown cities */
+static const double *city_month_weights(const AppData *data, const char *city, WeatherType weather, double buf[12]) {
+	return climate_month_weights(&data->climate, city, weather, buf) ? buf : NULL;
+}
+
+/* Weather, hemisphere and up to n options for city. When the gazetteer
+ * knows the city and prefetching is on, options are drawn for the likely
+ * weather types up front so their events load while the weather does.
+ * Returns 0 if the weather lookup failed */
+static int plan_recommendation(UpstreamClient *client, const AppData *data, const AppOptions *opts, const Deadline *deadline, const char *city,
+	const char *weather_key, const char *events_key, int n, WeatherReport *report, Hemisphere *hemi_out, ActivityOption *options, int *count) {
+	if (n > PREFETCH_MAX_OPTIONS) n = PREFETCH_MAX_OPTIONS;
+	Hemisphere hemi = HEMISPHERE_NORTH;
+	int located = city_hemisphere(data, city, &hemi);
+	OptionPlan plans[PREFETCH_MAX_PLANS];
+	int chosen = -1;
+	if (located && opts->prefetch_types > 0 && events_key && events_key[0]) {
+		WeatherType likely[PREFETCH_MAX_PLANS];
+		int nplans = likely_weather_types(&data->climate, city, hemi, likely, opts->prefetch_types);
+		for (int p = 0; p < nplans; ++p) {
+			double month_buf[12];
+			plans[p].weather = likely[p];
+			plans[p].count = generate_activity_options(&data->catalog, hemi, likely[p],
+				city_month_weights(data, city, likely[p], month_buf), plans[p].options, n);
+		}
+		if (!prefetch_weather_and_events(client, deadline, city, weather_key, events_key, opts->ranged_events, plans, nplans, n, report, &chosen)) return 0;
+	} else if (!fetch_weather_report(client, deadline, city, weather_key, report)) {
+		return 0;
+	}
+	if (!located) hemi = hemisphere_from_lat(report->lat);
+	if (chosen >= 0) {
+		*count = plans[chosen].count;
+		memcpy(options, plans[chosen].options, (size_t)*count * sizeof(ActivityOption));
+	} else {
+		WeatherType weather = map_openweather_main_to_type(report->main);
+		double month_buf[12];
+		const double *month_weights = city_month_weights(data, city, weather, month_buf);
+		*count = generate_activity_options(&data->catalog, hemi, weather, month_weights, options, n);
+	}
+	*hemi_out = hemi;
+	return 1;
+}
+
+/* ---------------- Local HTTP Service Mode ---------------- */
+
+#define SERVER_MAX_CONNS 256
+#define SERVER_MAX_REQUEST 8192
+#define SERVER_IDLE_TIMEOUT 30
+#define MAX_RECOMMEND_OPTIONS 12
+
+/* Linux suppresses SIGPIPE per send() call, macOS/BSD per socket */
+#ifdef MSG_NOSIGNAL
+#define SEND_NOSIGNAL MSG_NOSIGNAL
+#else
+#define SEND_NOSIGNAL 0
+#endif
+
+typedef struct {
+	UpstreamClient *client;
+	const AppData *data;
+	const AppOptions *opts;
+	char openweather_key[128];
+	char ticketmaster_key[128];
+} ServiceContext;
+
+static volatile sig_atomic_t server_stop = 0;
+
+static void handle_stop_signal(int sig) {
+	(void)sig;
+	server_stop = 1;
+}
+
+static void json_append_string(MemoryBuffer *out, const char *s) {
+	buffer_append(out, "\"", 1);
+	for (; s && *s; ++s) {
+		unsigned char c = (unsigned char)*s;
+		if (c == '"' || c == '\\') {
+			char esc[2] = {'\\', (char)c};
+			buffer_append(out, esc, 2);
+		} else if (c < 0x20) {
+			buffer_appendf(out, "\\u%04x", c);
+		} else {
+			buffer_append(out, (const char *)&c, 1);
+		}
+	}
+	buffer_append(out, "\"", 1);
+}
+
+static int hex_value(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+/* Find name=value in a query string and percent-decode it into out */
+static int query_param(const char *query, const char *name, char *out, size_t outsz) {
+	if (!query || !name || !out || outsz == 0) return 0;
+	size_t name_len = strlen(name);
+	const char *p = query;
+	while (*p) {
+		const char *end = strchr(p, '&');
+		if (!end) end = p + strlen(p);
+		if ((size_t)(end - p) > name_len && strncmp(p, name, name_len) == 0 && p[name_len] == '=') {
+			const char *v = p + name_len + 1;
+			size_t i = 0;
+			while (v < end && i + 1 < outsz) {
+				if (*v == '+') { out[i++] = ' '; v++; }
+				else if (*v == '%' && end - v >= 3 && hex_value(v[1]) >= 0 && hex_value(v[2]) >= 0) {
+					out[i++] = (char)(hex_value(v[1]) * 16 + hex_value(v[2]));
+					v += 3;
+				} else {
+					out[i++] = *v++;
+				}
+			}
+			out[i] = '\0';
 			return 1;
 		}
-		free(chunk.data);
+		p = (*end == '&') ? end + 1 : end;
 	}
-	curl_easy_cleanup(curl);
 	return 0;
 }
 
-static int parse_ticketmaster_event_names(const char *json, char names[][128], int max_names) {
-	if (!json || !names || max_names <= 0) return 0;
-	/* Scope into _embedded { events: [ { name: "..." } ] } */
-	const char *emb = strstr(json, "\"_embedded\"");
-	if (!emb) return 0;
-	const char *brace = strchr(emb, '{');
-	if (!brace) return 0;
-	int depth = 1; const char *p = brace + 1;
-	const char *events = NULL;
-	while (*p && depth > 0) {
-		if (*p == '{') depth++;
-		else if (*p == '}') depth--;
-		else if (!events) {
-			const char *ev = strstr(p, "\"events\"");
-			if (ev && ev < strchr(p, '}')) { events = ev; break; }
-		}
-		p++;
+static int handle_recommend(ServiceContext *ctx, const char *query, MemoryBuffer *body) {
+	char city[128];
+	if (!query_param(query, "city", city, sizeof(city)) || city[0] == '\0') {
+		buffer_appendf(body, "{\"error\":\"missing city\"}");
+		return 400;
 	}
-	if (!events) return 0;
-	const char *arr = strchr(events, '[');
-	if (!arr) return 0;
-	/* Iterate names inside events array */
-	depth = 0; p = arr;
+	int n = 6;
+	char n_str[16];
+	if (query_param(query, "n", n_str, sizeof(n_str))) n = atoi(n_str);
+	if (n < 1) n = 1;
+	if (n > MAX_RECOMMEND_OPTIONS) n = MAX_RECOMMEND_OPTIONS;
+
+	/* One budget covers the weather call and every events call below */
+	Deadline deadline = deadline_in(REQUEST_BUDGET_MS);
+	WeatherReport report;
+	Hemisphere hemi;
+	ActivityOption options[MAX_RECOMMEND_OPTIONS];
 	int count = 0;
-	while (*p && count < max_names) {
-		if (*p == '[') depth++;
-		else if (*p == ']') { depth--; if (depth <= 0) break; }
-		else if (*p == '"' && depth > 0) {
-			if (extract_json_string_field(p, "name", names[count], 128)) {
-				/* Filter out generic container names if any */
-				if (strlen(names[count]) > 0) count++;
+	if (!plan_recommendation(ctx->client, ctx->data, ctx->opts, &deadline, city, ctx->openweather_key, ctx->ticketmaster_key, n, &report, &hemi, options, &count)) {
+		buffer_appendf(body, "{\"error\":\"weather lookup failed\"}");
+		return 502;
+	}
+	EventList events[MAX_RECOMMEND_OPTIONS];
+	int events_ok[MAX_RECOMMEND_OPTIONS] = {0};
+	if (ctx->ticketmaster_key[0]) {
+		fetch_option_events(ctx->client, &deadline, city, ctx->ticketmaster_key, ctx->opts->ranged_events, options, count, events, events_ok);
+	}
+	buffer_appendf(body, "{\"city\":");
+	json_append_string(body, city);
+	buffer_appendf(body, ",\"weather\":");
+	json_append_string(body, report.main[0] ? report.main : "unknown");
+	buffer_appendf(body, ",\"hemisphere\":\"%s\",\"options\":[", hemi == HEMISPHERE_SOUTH ? "south" : "north");
+	for (int i = 0; i < count; ++i) {
+		buffer_appendf(body, "%s{\"date\":\"%04d-%02d-%02d\",\"activity\":", i ? "," : "",
+			options[i].year, options[i].month, options[i].day);
+		json_append_string(body, options[i].activity);
+		if (events_ok[i]) {
+			buffer_appendf(body, ",\"events\":[");
+			for (int k = 0; k < events[i].count; ++k) {
+				if (k) buffer_append(body, ",", 1);
+				json_append_string(body, events[i].names[k]);
 			}
+			buffer_append(body, "]", 1);
+		} else {
+			buffer_appendf(body, ",\"events\":null");
 		}
-		p++;
+		buffer_append(body, "}", 1);
 	}
-	return count;
+	buffer_appendf(body, "]}");
+	return 200;
+}
+
+static int route_request(ServiceContext *ctx, const char *target, MemoryBuffer *body, const char **content_type) {
+	const char *q = strchr(target, '?');
+	size_t path_len = q ? (size_t)(q - target) : strlen(target);
+	*content_type = "application/json";
+	if (path_len == 10 && strncmp(target, "/recommend", 10) == 0) return handle_recommend(ctx, q ? q + 1 : "", body);
+	if (path_len == 8 && strncmp(target, "/metrics", 8) == 0) {
+		char format[16];
+		if (q && query_param(q + 1, "format", format, sizeof(format)) && strcmp(format, "json") == 0) {
+			metrics_write_json(ctx->client, body);
+		} else {
+			*content_type = "text/plain; version=0.0.4";
+			metrics_write_prometheus(ctx->client, body);
+		}
+		return 200;
+	}
+	if (path_len == 8 && strncmp(target, "/healthz", 8) == 0) {
+		buffer_appendf(body, "{\"status\":\"ok\"}");
+		return 200;
+	}
+	buffer_appendf(body, "{\"error\":\"not found\"}");
+	return 404;
+}
+
+static const char *http_status_text(int status) {
+	switch (status) {
+		case 200: return "OK";
+		case 400: return "Bad Request";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		case 502: return "Bad Gateway";
+		default: return "Internal Server Error";
+	}
+}
+
+static char *format_http_response(int status, const char *content_type, const MemoryBuffer *body, int close_after, size_t *out_len) {
+	MemoryBuffer resp = {0};
+	buffer_appendf(&resp,
+		"HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+		status, http_status_text(status), content_type, body->size, close_after ? "close" : "keep-alive");
+	if (body->size > 0) buffer_append(&resp, body->data, body->size);
+	*out_len = resp.size;
+	return resp.data;
+}
+
+/* Parse a buffered request head. Returns the number of bytes it spans, 0 if
+ * more input is needed, or -1 if the request is malformed. */
+static int parse_http_request(const char *buf, size_t len, char *method, size_t method_sz, char *target, size_t target_sz, int *close_after) {
+	(void)len;
+	const char *head_end = strstr(buf, "\r\n\r\n");
+	if (!head_end) return 0;
+	const char *line_end = strstr(buf, "\r\n");
+	const char *sp1 = memchr(buf, ' ', (size_t)(line_end - buf));
+	if (!sp1) return -1;
+	const char *sp2 = memchr(sp1 + 1, ' ', (size_t)(line_end - sp1 - 1));
+	if (!sp2) return -1;
+	if ((size_t)(sp1 - buf) >= method_sz || (size_t)(sp2 - sp1 - 1) >= target_sz) return -1;
+	memcpy(method, buf, (size_t)(sp1 - buf));
+	method[sp1 - buf] = '\0';
+	memcpy(target, sp1 + 1, (size_t)(sp2 - sp1 - 1));
+	target[sp2 - sp1 - 1] = '\0';
+	/* HTTP/1.1 defaults to keep-alive, HTTP/1.0 to close */
+	*close_after = strncmp(sp2 + 1, "HTTP/1.1", 8) != 0;
+	const char *h = line_end + 2;
+	while (h < head_end) {
+		const char *eol = strstr(h, "\r\n");
+		if (strncasecmp(h, "connection:", 11) == 0) {
+			char value[64];
+			size_t vlen = (size_t)(eol - h - 11);
+			if (vlen >= sizeof(value)) vlen = sizeof(value) - 1;
+			memcpy(value, h + 11, vlen);
+			value[vlen] = '\0';
+			to_lower_str(value);
+			if (strstr(value, "close")) *close_after = 1;
+			else if (strstr(value, "keep-alive")) *close_after = 0;
+		} else if (strncasecmp(h, "content-length:", 15) == 0 && atol(h + 15) != 0) {
+			/* Request bodies are never expected */
+			return -1;
+		}
+		h = eol + 2;
+	}
+	return (int)(head_end + 4 - buf);
+}
+
+typedef enum {
+	CONN_FREE = 0,
+	CONN_READING,
+	CONN_BUSY,
+	CONN_WRITING
+} ConnState;
+
+typedef struct {
+	int fd;
+	ConnState state;
+	unsigned generation;
+	char in[SERVER_MAX_REQUEST + 1];
+	size_t in_len;
+	char *out;
+	size_t out_len;
+	size_t out_off;
+	int close_after;
+	time_t last_active;
+} ServerConn;
+
+typedef struct ServerJob {
+	int slot;
+	unsigned generation;
+	int close_after;
+	char target[1024];
+	char *response;
+	size_t response_len;
+	struct ServerJob *next;
+} ServerJob;
+
+/* Requests are parsed on the event loop and handed to workers, which do the
+ * blocking upstream work and post finished responses back through a pipe. */
+typedef struct {
+	ServiceContext *ctx;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	ServerJob *pending_head;
+	ServerJob *pending_tail;
+	ServerJob *done;
+	int wake_pipe[2];
+	int shutting_down;
+} ServerQueue;
+
+static void *server_worker(void *arg) {
+	ServerQueue *q = (ServerQueue *)arg;
+	for (;;) {
+		pthread_mutex_lock(&q->lock);
+		while (!q->pending_head && !q->shutting_down) pthread_cond_wait(&q->ready, &q->lock);
+		ServerJob *job = q->pending_head;
+		if (!job) {
+			pthread_mutex_unlock(&q->lock);
+			break;
+		}
+		q->pending_head = job->next;
+		if (!q->pending_head) q->pending_tail = NULL;
+		pthread_mutex_unlock(&q->lock);
+
+		MemoryBuffer body = {0};
+		const char *content_type = NULL;
+		int status = route_request(q->ctx, job->target, &body, &content_type);
+		job->response = format_http_response(status, content_type, &body, job->close_after, &job->response_len);
+		free(body.data);
+
+		pthread_mutex_lock(&q->lock);
+		job->next = q->done;
+		q->done = job;
+		pthread_mutex_unlock(&q->lock);
+		ssize_t w = write(q->wake_pipe[1], "x", 1);
+		(void)w;
+	}
+	upstream_thread_release();
+	return NULL;
+}
+
+static void conn_close(ServerConn *c) {
+	close(c->fd);
+	free(c->out);
+	c->out = NULL;
+	c->fd = -1;
+	c->state = CONN_FREE;
+	c->in_len = 0;
+	c->generation++;
+}
+
+static void conn_reply_error(ServerConn *c, int status) {
+	MemoryBuffer body = {0};
+	buffer_appendf(&body, "{\"error\":\"%s\"}", http_status_text(status));
+	c->out = format_http_response(status, "application/json", &body, 1, &c->out_len);
+	free(body.data);
+	c->out_off = 0;
+	c->close_after = 1;
+	c->state = CONN_WRITING;
+}
+
+/* Hand the next buffered request on a connection to the worker pool */
+static void conn_try_dispatch(ServerQueue *q, ServerConn *conns, int slot) {
+	ServerConn *c = &conns[slot];
+	if (c->state != CONN_READING || c->in_len == 0) return;
+	c->in[c->in_len] = '\0';
+	char method[16];
+	ServerJob *job = (ServerJob *)calloc(1, sizeof(ServerJob));
+	if (!job) { conn_close(c); return; }
+	int used = parse_http_request(c->in, c->in_len, method, sizeof(method), job->target, sizeof(job->target), &job->close_after);
+	if (used == 0 && c->in_len < SERVER_MAX_REQUEST) {
+		free(job);
+		return;
+	}
+	if (used <= 0) {
+		free(job);
+		conn_reply_error(c, 400);
+		return;
+	}
+	if (strcmp(method, "GET") != 0) {
+		free(job);
+		conn_reply_error(c, 405);
+		return;
+	}
+	/* Keep any pipelined bytes for the next request */
+	memmove(c->in, c->in + used, c->in_len - (size_t)used);
+	c->in_len -= (size_t)used;
+	job->slot = slot;
+	job->generation = c->generation;
+	c->state = CONN_BUSY;
+	pthread_mutex_lock(&q->lock);
+	if (q->pending_tail) q->pending_tail->next = job;
+	else q->pending_head = job;
+	q->pending_tail = job;
+	pthread_cond_signal(&q->ready);
+	pthread_mutex_unlock(&q->lock);
+}
+
+static void conn_flush(ServerQueue *q, ServerConn *conns, int slot) {
+	ServerConn *c = &conns[slot];
+	while (c->out_off < c->out_len) {
+		ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, SEND_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+			conn_close(c);
+			return;
+		}
+		c->out_off += (size_t)n;
+	}
+	free(c->out);
+	c->out = NULL;
+	c->last_active = time(NULL);
+	if (c->close_after) {
+		conn_close(c);
+		return;
+	}
+	c->state = CONN_READING;
+	conn_try_dispatch(q, conns, slot);
+}
+
+static int set_nonblocking(int fd) {
+	int flags = fcntl(fd, F_GETFL, 0);
+	return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static int run_server(ServiceContext *ctx, int port, int workers) {
+	int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0) { perror("socket"); return 1; }
+	int one = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons((unsigned short)port);
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 128) != 0 || !set_nonblocking(listen_fd)) {
+		perror("bind/listen");
+		close(listen_fd);
+		return 1;
+	}
+
+	ServerQueue q;
+	memset(&q, 0, sizeof(q));
+	q.ctx = ctx;
+	pthread_mutex_init(&q.lock, NULL);
+	pthread_cond_init(&q.ready, NULL);
+	if (pipe(q.wake_pipe) != 0 || !set_nonblocking(q.wake_pipe[0])) {
+		perror("pipe");
+		close(listen_fd);
+		return 1;
+	}
+	if (workers < 1) workers = 1;
+	if (workers > 64) workers = 64;
+	pthread_t threads[64];
+	int started = 0;
+	for (; started < workers; ++started) {
+		if (pthread_create(&threads[started], NULL, server_worker, &q) != 0) break;
+	}
+
+	static ServerConn conns[SERVER_MAX_CONNS];
+	for (int i = 0; i < SERVER_MAX_CONNS; ++i) {
+		conns[i].fd = -1;
+		conns[i].state = CONN_FREE;
+	}
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = handle_stop_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	printf("datePicker listening on http://127.0.0.1:%d (%d workers)\n", port, started);
+	fflush(stdout);
+
+	struct pollfd pfds[SERVER_MAX_CONNS + 2];
+	int pfd_slot[SERVER_MAX_CONNS + 2];
+	while (!server_stop) {
+		int nfds = 0;
+		pfds[nfds].fd = listen_fd; pfds[nfds].events = POLLIN; pfd_slot[nfds++] = -1;
+		pfds[nfds].fd = q.wake_pipe[0]; pfds[nfds].events = POLLIN; pfd_slot[nfds++] = -1;
+		for (int i = 0; i < SERVER_MAX_CONNS; ++i) {
+			if (conns[i].state == CONN_READING) pfds[nfds].events = POLLIN;
+			else if (conns[i].state == CONN_WRITING) pfds[nfds].events = POLLOUT;
+			else continue;
+			pfds[nfds].fd = conns[i].fd;
+			pfd_slot[nfds++] = i;
+		}
+		int ready = poll(pfds, (nfds_t)nfds, 1000);
+		if (ready < 0) {
+			if (errno == EINTR) continue;
+			perror("poll");
+			break;
+		}
+
+		if (pfds[1].revents & POLLIN) {
+			char drain[64];
+			while (read(q.wake_pipe[0], drain, sizeof(drain)) > 0) {}
+			pthread_mutex_lock(&q.lock);
+			ServerJob *done = q.done;
+			q.done = NULL;
+			pthread_mutex_unlock(&q.lock);
+			while (done) {
+				ServerJob *next = done->next;
+				ServerConn *c = &conns[done->slot];
+				if (c->state == CONN_BUSY && c->generation == done->generation && done->response) {
+					c->out = done->response;
+					c->out_len = done->response_len;
+					c->out_off = 0;
+					c->close_after = done->close_after;
+					c->state = CONN_WRITING;
+					conn_flush(&q, conns, done->slot);
+				} else {
+					if (c->state == CONN_BUSY && c->generation == done->generation) conn_close(c);
+					free(done->response);
+				}
+				free(done);
+				done = next;
+			}
+		}
+
+		for (int i = 2; i < nfds; ++i) {
+			ServerConn *c = &conns[pfd_slot[i]];
+			if (c->fd != pfds[i].fd) continue;
+			if (c->state == CONN_READING && (pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+				ssize_t n = recv(c->fd, c->in + c->in_len, SERVER_MAX_REQUEST - c->in_len, 0);
+				if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+					conn_close(c);
+					continue;
+				}
+				if (n > 0) {
+					c->in_len += (size_t)n;
+					c->last_active = time(NULL);
+					conn_try_dispatch(&q, conns, pfd_slot[i]);
+				}
+			} else if (c->state == CONN_WRITING && (pfds[i].revents & (POLLOUT | POLLHUP | POLLERR))) {
+				conn_flush(&q, conns, pfd_slot[i]);
+			}
+		}
+
+		if (pfds[0].revents & POLLIN) {
+			for (;;) {
+				int fd = accept(listen_fd, NULL, NULL);
+				if (fd < 0) break;
+				int slot = -1;
+				for (int i = 0; i < SERVER_MAX_CONNS; ++i) {
+					if (conns[i].state == CONN_FREE) { slot = i; break; }
+				}
+				if (slot < 0 || !set_nonblocking(fd)) {
+					close(fd);
+					continue;
+				}
+#ifdef SO_NOSIGPIPE
+				setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+				conns[slot].fd = fd;
+				conns[slot].state = CONN_READING;
+				conns[slot].in_len = 0;
+				conns[slot].last_active = time(NULL);
+			}
+		}
+
+		/* Drop idle keep-alive connections */
+		time_t now = time(NULL);
+		for (int i = 0; i < SERVER_MAX_CONNS; ++i) {
+			if (conns[i].state == CONN_READING && now - conns[i].last_active > SERVER_IDLE_TIMEOUT) conn_close(&conns[i]);
+		}
+	}
+
+	pthread_mutex_lock(&q.lock);
+	q.shutting_down = 1;
+	pthread_cond_broadcast(&q.ready);
+	pthread_mutex_unlock(&q.lock);
+	for (int i = 0; i < started; ++i) pthread_join(threads[i], NULL);
+	while (q.pending_head) {
+		ServerJob *next = q.pending_head->next;
+		free(q.pending_head);
+		q.pending_head = next;
+	}
+	while (q.done) {
+		ServerJob *next = q.done->next;
+		free(q.done->response);
+		free(q.done);
+		q.done = next;
+	}
+	for (int i = 0; i < SERVER_MAX_CONNS; ++i) {
+		if (conns[i].state != CONN_FREE) conn_close(&conns[i]);
+	}
+	close(q.wake_pipe[0]);
+	close(q.wake_pipe[1]);
+	close(listen_fd);
+	pthread_cond_destroy(&q.ready);
+	pthread_mutex_destroy(&q.lock);
+	return 0;
+}
+
+static int run_service(UpstreamClient *client, const AppData *data, const AppOptions *opts) {
+	/* Keys are read once at startup; the service never prompts */
+	ServiceContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.client = client;
+	ctx.data = data;
+	ctx.opts = opts;
+	const char *ow = getenv("OPENWEATHER_API_KEY");
+	const char *tm = getenv("TICKETMASTER_API_KEY");
+	if (!ow || !*ow) {
+		fprintf(stderr, "OPENWEATHER_API_KEY must be set in service mode.\n");
+		return 1;
+	}
+	snprintf(ctx.openweather_key, sizeof(ctx.openweather_key), "%s", ow);
+	if (tm && *tm) snprintf(ctx.ticketmaster_key, sizeof(ctx.ticketmaster_key), "%s", tm);
+	else fprintf(stderr, "TICKETMASTER_API_KEY not set; responses will omit events.\n");
+	return run_server(&ctx, opts->serve_port, opts->workers);
+}
+
+/* ---------------- Benchmark Mode ---------------- */
+
+static int compare_double(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile over a sorted sample */
+static double percentile(const double *sorted, int n, double pct) {
+	if (n <= 0) return 0.0;
+	int rank = (int)(pct / 100.0 * n + 0.999999);
+	if (rank < 1) rank = 1;
+	if (rank > n) rank = n;
+	return sorted[rank - 1];
+}
+
+/* Re-parse one captured payload for ~500ms and report MB/s */
+static void bench_parse(const char *label, const char *json, int events_payload) {
+	size_t len = strlen(json);
+	double start = precise_ms();
+	long iterations = 0;
+	while (precise_ms() - start < 500.0) {
+		for (int k = 0; k < 64; ++k) {
+			if (events_payload) {
+				EventDayIndex index;
+				memset(&index, 0, sizeof(index));
+				int total_pages = 0, last_key = 0;
+				long total_events = 0;
+				index_ticketmaster_page(json, &index, &total_pages, &total_events, &last_key);
+				event_index_free(&index);
+			} else {
+				char main_out[64];
+				double lat = 0.0;
+				parse_openweather_payload(json, main_out, sizeof(main_out), &lat);
+			}
+		}
+		iterations += 64;
+	}
+	double secs = (precise_ms() - start) / 1000.0;
+	printf("  %-18s %8zu bytes  %10.0f parses/s  %8.1f MB/s\n", label, len,
+		iterations / secs, (double)len * iterations / secs / (1024.0 * 1024.0));
+}
+
+/* Drives the full weather -> options -> events pipeline against whatever the
+ * base URLs point at (normally mockUpstream) with response caches cleared
+ * before every iteration, so each one pays for real upstream round trips. */
+static int run_bench(UpstreamClient *client, const AppData *data, const AppOptions *opts) {
+	const char *ow = getenv("OPENWEATHER_API_KEY");
+	const char *tm = getenv("TICKETMASTER_API_KEY");
+	if (!ow || !*ow) ow = "bench";
+	if (!tm || !*tm) tm = "bench";
+	int iterations = opts->bench_iterations;
+	double *latencies = (double *)calloc((size_t)iterations, sizeof(double));
+	if (!latencies) return 1;
+	unsigned long ow_before = client->openweather.requests;
+	unsigned long tm_before = client->ticketmaster.requests;
+	int failures = 0;
+	double bench_start = precise_ms();
+	for (int i = 0; i < iterations; ++i) {
+		cache_clear(&client->weather_cache);
+		cache_clear(&client->events_cache);
+		double start = precise_ms();
+		Deadline deadline = deadline_in(REQUEST_BUDGET_MS);
+		WeatherReport report;
+		Hemisphere hemi;
+		ActivityOption options[6];
+		int count = 0;
+		if (!plan_recommendation(client, data, opts, &deadline, opts->bench_city, ow, tm, 6, &report, &hemi, options, &count)) {
+			failures++;
+		} else {
+			EventList events[6];
+			int events_ok[6];
+			fetch_option_events(client, &deadline, opts->bench_city, tm, opts->ranged_events, options, count, events, events_ok);
+			for (int k = 0; k < count; ++k) {
+				if (!events_ok[k]) { failures++; break; }
+			}
+		}
+		latencies[i] = precise_ms() - start;
+	}
+	double wall_s = (precise_ms() - bench_start) / 1000.0;
+	unsigned long ow_requests = client->openweather.requests - ow_before;
+	unsigned long tm_requests = client->ticketmaster.requests - tm_before;
+
+	double sum = 0.0;
+	for (int i = 0; i < iterations; ++i) sum += latencies[i];
+	qsort(latencies, (size_t)iterations, sizeof(double), compare_double);
+	printf("datePicker bench: %d iterations, city=%s, events=%s, prefetch=%d\n", iterations, opts->bench_city,
+		opts->ranged_events ? "ranged" : "per-day", opts->prefetch_types);
+	printf("  openweather: %s\n  ticketmaster: %s\n", client->openweather.base_url, client->ticketmaster.base_url);
+	printf("End-to-end latency (ms): mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+		sum / iterations, percentile(latencies, iterations, 50), percentile(latencies, iterations, 90),
+		percentile(latencies, iterations, 99), latencies[iterations - 1]);
+	printf("Throughput: %.1f runs/s  failed runs: %d\n", iterations / wall_s, failures);
+	printf("Upstream requests: openweather %lu (%.2f/run)  ticketmaster %lu (%.2f/run)\n",
+		ow_requests, (double)ow_requests / iterations, tm_requests, (double)tm_requests / iterations);
+	free(latencies);
+
+	/* Parse throughput on one freshly fetched payload of each kind */
+	printf("Parse throughput:\n");
+	Deadline deadline = deadline_in(REQUEST_BUDGET_MS);
+	char url[1280];
+	char *json = NULL;
+	if (openweather_url(client, opts->bench_city, ow, url, sizeof(url)) && fetch_openweather_json(client, &deadline, url, &json)) {
+		bench_parse("openweather", json, 0);
+		free(json);
+	}
+	json = NULL;
+	time_t now = time(NULL);
+	struct tm lt;
+	localtime_r(&now, &lt);
+	char start_iso[32], end_iso[32], extra[96];
+	strftime(start_iso, sizeof(start_iso), "%Y-%m-%dT00:00:00Z", &lt);
+	now += 30 * 24 * 3600;
+	localtime_r(&now, &lt);
+	strftime(end_iso, sizeof(end_iso), "%Y-%m-%dT23:59:59Z", &lt);
+	snprintf(extra, sizeof(extra), "size=%d&page=0&sort=date,asc", RANGE_PAGE_SIZE);
+	if (build_ticketmaster_url(client, opts->bench_city, tm, start_iso, end_iso, extra, url, sizeof(url)) &&
+		fetch_ticketmaster_json(client, &deadline, url, &json)) {
+		bench_parse("ticketmaster page", json, 1);
+		free(json);
+	}
+	return failures > 0;
 }
 
-int main(void) {
-	/* Seed once */
-	srand((unsigned int)time(NULL));
+static void print_usage(const char *prog) {
+	fprintf(stderr,
+		"Usage: %s [--serve PORT [--workers N] | --bench N [--city C]] [--ranged-events]\n"
+		"          [--metrics prom|json [--metrics-out FILE]] [--catalog FILE] [--climate FILE]\n"
+		"          [--gazetteer FILE] [--prefetch-events N]\n"
+		"       %s --build-catalog SOURCE.txt OUT.cat\n"
+		"       %s --build-climate SOURCE.csv OUT.idx\n"
+		"       %s --build-gazetteer SOURCE.csv OUT.gaz\n"
+		"       %s --print-builtin catalog|gazetteer\n"
+		"  (no args)        interactive one-shot mode\n"
+		"  --serve PORT     run as a local HTTP service: GET /recommend?city=...&n=6\n"
+		"  --workers N      worker threads for upstream calls in service mode (default 4)\n"
+		"  --bench N        run the pipeline N times against the configured upstreams and\n"
+		"                   report latency percentiles, request counts and parse throughput\n"
+		"  --city C         city used by --bench (default Austin,US)\n"
+		"  --ranged-events  fetch events for nearby option dates with shared ranged queries,\n"
+		"                   bucketed by UTC day\n"
+		"  --prefetch-events N  service/bench: while the weather call is in flight, prefetch\n"
+		"                   events for options drawn for the N likeliest weather types (1-6)\n"
+		"  --metrics FMT    dump per-endpoint upstream metrics at exit (prom or json);\n"
+		"                   service mode also serves them at /metrics[?format=json]\n"
+		"  --metrics-out F  write the exit dump to F instead of stderr\n"
+		"  --catalog FILE   mmap a compiled activity catalog (default: $DATEPICKER_CATALOG,\n"
+		"                   else the built-in list)\n"
+		"  --build-catalog  compile '<weather> <season[,season]|*> <activity>' lines into a catalog\n"
+		"  --print-builtin catalog|gazetteer  write that built-in source to stdout\n"
+		"  --climate FILE   mmap a compiled climatology index and weight months by each city's\n"
+		"                   observed weather frequencies (default: $DATEPICKER_CLIMATE)\n"
+		"  --build-climate  compile 'city,country,weather,jan..dec' frequency rows into an index\n"
+		"  --gazetteer FILE mmap a compiled city gazetteer used to resolve the hemisphere offline\n"
+		"                   (default: $DATEPICKER_GAZETTEER, else the built-in city list)\n"
+		"  --build-gazetteer compile 'city,country,lat,lon' rows into a gazetteer\n",
+		prog, prog, prog, prog, prog);
+}
 
+static int run_interactive(UpstreamClient *client, const AppData *data, const AppOptions *opts) {
 	char city[128];
 	char api_key_input[128];
 	printf("Enter city (e.g., London or Austin,US): ");
@@ -550,25 +4079,51 @@ int main(void) {
 		trim_newline(api_key_input);
 	}
 
-	char *json = NULL;
-	if (!fetch_openweather_json(city, api_key_input, &json)) {
+	/* The gazetteer settles the hemisphere offline; the weather call is only
+	 * for current conditions and runs while the Ticketmaster key is read */
+	Hemisphere hemi = HEMISPHERE_NORTH;
+	int located = city_hemisphere(data, city, &hemi);
+	WeatherTask weather_task;
+	weather_task_start(&weather_task, client, deadline_in(REQUEST_BUDGET_MS), city, api_key_input);
+
+	/* Ask for Ticketmaster API Key */
+	char tm_api_key[128];
+	const char *tm_env = getenv("TICKETMASTER_API_KEY");
+	if (tm_env && *tm_env) {
+		strncpy(tm_api_key, tm_env, sizeof(tm_api_key) - 1);
+		tm_api_key[sizeof(tm_api_key) - 1] = '\0';
+	} else {
+		printf("Enter Ticketmaster API key: ");
+		fflush(stdout);
+		if (!fgets(tm_api_key, sizeof(tm_api_key), stdin)) {
+			weather_task_join(&weather_task);
+			return 1;
+		}
+		trim_newline(tm_api_key);
+	}
+
+	if (!weather_task_join(&weather_task)) {
 		fprintf(stderr, "Failed to fetch weather for %s. Falling back to manual input.\n", city);
 		char hemi_input[64];
 		char weather_input[64];
-		printf("Enter hemisphere (north/south): ");
-		fflush(stdout);
-		if (!fgets(hemi_input, sizeof(hemi_input), stdin)) return 1;
-		trim_newline(hemi_input);
-		to_lower_str(hemi_input);
+		if (!located) {
+			printf("Enter hemisphere (north/south): ");
+			fflush(stdout);
+			if (!fgets(hemi_input, sizeof(hemi_input), stdin)) return 1;
+			trim_newline(hemi_input);
+			to_lower_str(hemi_input);
+			hemi = parse_hemisphere(hemi_input);
+		}
 		printf("Enter weather type (sunny/rainy/snowy/windy/cloudy/stormy/any): ");
 		fflush(stdout);
 		if (!fgets(weather_input, sizeof(weather_input), stdin)) return 1;
 		trim_newline(weather_input);
 		to_lower_str(weather_input);
-		Hemisphere hemi_fallback = parse_hemisphere(hemi_input);
 		WeatherType weather_fallback = parse_weather(weather_input);
+		double month_buf[12];
+		const double *month_weights = city_month_weights(data, city, weather_fallback, month_buf);
 		ActivityOption opts[5];
-		int n = generate_activity_options(hemi_fallback, weather_fallback, opts, 5);
+		int n = generate_activity_options(&data->catalog, hemi, weather_fallback, month_weights, opts, 5);
 		printf("\nActivity date options (fallback):\n");
 		for (int i = 0; i < n; ++i) {
 			printf("- %04d-%02d-%02d: %s\n", opts[i].year, opts[i].month, opts[i].day, opts[i].activity);
@@ -576,40 +4131,27 @@ int main(void) {
 		return 0;
 	}
 
-	char weather_main[64] = {0};
-	double lat = 0.0;
-	parse_openweather_payload(json, weather_main, sizeof(weather_main), &lat);
-	free(json);
-	Hemisphere hemi = hemisphere_from_lat(lat);
-	WeatherType weather = map_openweather_main_to_type(weather_main);
-
-	/* Ask for Ticketmaster API Key */
-	char tm_api_key[128];
-	const char *tm_env = getenv("TICKETMASTER_API_KEY");
-	if (tm_env && *tm_env) {
-		strncpy(tm_api_key, tm_env, sizeof(tm_api_key) - 1);
-		tm_api_key[sizeof(tm_api_key) - 1] = '\0';
-	} else {
-		printf("Enter Ticketmaster API key: ");
-		fflush(stdout);
-		if (!fgets(tm_api_key, sizeof(tm_api_key), stdin)) return 1;
-		trim_newline(tm_api_key);
-	}
+	const WeatherReport report = weather_task.report;
+	if (!located) hemi = hemisphere_from_lat(report.lat);
+	WeatherType weather = map_openweather_main_to_type(report.main);
 
+	/* Fresh budget for the events phase; the prompt above may have waited on the user */
+	Deadline deadline = deadline_in(REQUEST_BUDGET_MS);
+	double month_buf[12];
+	const double *month_weights = city_month_weights(data, city, weather, month_buf);
 	ActivityOption options[6];
-	int count = generate_activity_options(hemi, weather, options, 6);
-	printf("\nCurrent weather: %s | Hemisphere: %s\n", weather_main[0] ? weather_main : "unknown", hemi == HEMISPHERE_SOUTH ? "south" : "north");
+	int count = generate_activity_options(&data->catalog, hemi, weather, month_weights, options, 6);
+	EventList events[6];
+	int events_ok[6];
+	fetch_option_events(client, &deadline, city, tm_api_key, opts->ranged_events, options, count, events, events_ok);
+	printf("\nCurrent weather: %s | Hemisphere: %s\n", report.main[0] ? report.main : "unknown", hemi == HEMISPHERE_SOUTH ? "south" : "north");
 	printf("Activity date options for %s (with events):\n", city);
 	for (int i = 0; i < count; ++i) {
 		printf("- %04d-%02d-%02d: %s\n", options[i].year, options[i].month, options[i].day, options[i].activity);
-		char *events_json = NULL;
-		if (fetch_ticketmaster_json(city, tm_api_key, options[i].year, options[i].month, options[i].day, &events_json)) {
-			char names[10][128];
-			int n = parse_ticketmaster_event_names(events_json, names, 5);
-			free(events_json);
-			if (n > 0) {
-				for (int k = 0; k < n; ++k) {
-					printf("    • %s\n", names[k]);
+		if (events_ok[i]) {
+			if (events[i].count > 0) {
+				for (int k = 0; k < events[i].count; ++k) {
+					printf("    • %s\n", events[i].names[k]);
 				}
 			} else {
 				printf("    (no events found)\n");
@@ -619,4 +4161,79 @@ int main(void) {
 		}
 	}
 	return 0;
-}
\ No newline at end of file
+}
+
+static void write_metrics_report(UpstreamClient *client, const AppOptions *opts) {
+	MemoryBuffer out = {0};
+	if (strcmp(opts->metrics_format, "json") == 0) metrics_write_json(client, &out);
+	else metrics_write_prometheus(client, &out);
+	FILE *f = opts->metrics_out ? fopen(opts->metrics_out, "w") : stderr;
+	if (!f) {
+		fprintf(stderr, "Cannot write metrics to %s\n", opts->metrics_out);
+	} else {
+		if (out.data) fwrite(out.data, 1, out.size, f);
+		if (f != stderr) fclose(f);
+	}
+	free(out.data);
+}
+
+int main(int argc, char **argv) {
+	AppOptions opts;
+	memset(&opts, 0, sizeof(opts));
+	opts.workers = 4;
+	snprintf(opts.bench_city, sizeof(opts.bench_city), "Austin,US");
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) opts.serve_port = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) opts.workers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--ranged-events") == 0) opts.ranged_events = 1;
+		else if (strcmp(argv[i], "--prefetch-events") == 0 && i + 1 < argc) opts.prefetch_types = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) opts.bench_iterations = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc && (strcmp(argv[i + 1], "prom") == 0 || strcmp(argv[i + 1], "json") == 0)) opts.metrics_format = argv[++i];
+		else if (strcmp(argv[i], "--metrics-out") == 0 && i + 1 < argc) opts.metrics_out = argv[++i];
+		else if (strcmp(argv[i], "--catalog") == 0 && i + 1 < argc) opts.catalog_path = argv[++i];
+		else if (strcmp(argv[i], "--build-catalog") == 0 && i + 2 < argc) return build_catalog_file(argv[i + 1], argv[i + 2]);
+		else if (strcmp(argv[i], "--print-builtin") == 0 && i + 1 < argc) return print_builtin_source(argv[i + 1]);
+		else if (strcmp(argv[i], "--climate") == 0 && i + 1 < argc) opts.climate_path = argv[++i];
+		else if (strcmp(argv[i], "--build-climate") == 0 && i + 2 < argc) return build_climate_file(argv[i + 1], argv[i + 2]);
+		else if (strcmp(argv[i], "--gazetteer") == 0 && i + 1 < argc) opts.gazetteer_path = argv[++i];
+		else if (strcmp(argv[i], "--build-gazetteer") == 0 && i + 2 < argc) return build_gazetteer_file(argv[i + 1], argv[i + 2]);
+		else if (strcmp(argv[i], "--city") == 0 && i + 1 < argc) snprintf(opts.bench_city, sizeof(opts.bench_city), "%s", argv[++i]);
+		else {
+			print_usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (!opts.catalog_path) {
+		const char *env_catalog = getenv("DATEPICKER_CATALOG");
+		if (env_catalog && *env_catalog) opts.catalog_path = env_catalog;
+	}
+	if (!opts.climate_path) {
+		const char *env_climate = getenv("DATEPICKER_CLIMATE");
+		if (env_climate && *env_climate) opts.climate_path = env_climate;
+	}
+	if (!opts.gazetteer_path) {
+		const char *env_gazetteer = getenv("DATEPICKER_GAZETTEER");
+		if (env_gazetteer && *env_gazetteer) opts.gazetteer_path = env_gazetteer;
+	}
+
+	AppData data;
+	if (!app_data_load(&data, &opts)) return 1;
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+	UpstreamClient client;
+	if (!upstream_client_init(&client)) {
+		fprintf(stderr, "Failed to initialize HTTP client.\n");
+		curl_global_cleanup();
+		app_data_free(&data);
+		return 1;
+	}
+	int rc;
+	if (opts.serve_port > 0) rc = run_service(&client, &data, &opts);
+	else if (opts.bench_iterations > 0) rc = run_bench(&client, &data, &opts);
+	else rc = run_interactive(&client, &data, &opts);
+	if (opts.metrics_format) write_metrics_report(&client, &opts);
+	upstream_client_cleanup(&client);
+	curl_global_cleanup();
+	app_data_free(&data);
+	return rc;
+}
@@ -0,0 +1,413 @@
+/* Local stand-in for the OpenWeather and Ticketmaster endpoints used by
+ * datePicker, with configurable latency, jitter, error rate and payload size. */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define MAX_REQUEST 8192
+#define MAX_WEATHER_MAINS 16
+
+typedef struct {
+	int port;
+	long latency_ms;
+	long jitter_ms;
+	double error_rate;
+	int events_per_day;
+	int pad_bytes;
+	const char *weather_file;
+	const char *events_file;
+	char *weather_mains[MAX_WEATHER_MAINS]; /* served in rotation */
+	int weather_main_count;
+} MockConfig;
+
+typedef struct {
+	unsigned long requests;
+	unsigned long weather;
+	unsigned long events;
+	unsigned long errors;
+	unsigned long bytes_out;
+} MockStats;
+
+static MockConfig config;
+static MockStats stats;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *recorded_weather = NULL;
+static char *recorded_events = NULL;
+static unsigned long weather_rotation = 0; /* guarded by stats_lock */
+
+typedef struct {
+	char *data;
+	size_t size;
+} Buffer;
+
+static void buf_append(Buffer *b, const char *src, size_t len) {
+	char *ptr = (char*)realloc(b->data, b->size + len + 1);
+	if (!ptr) return;
+	b->data = ptr;
+	memcpy(b->data + b->size, src, len);
+	b->size += len;
+	b->data[b->size] = '\0';
+}
+
+static void buf_appendf(Buffer *b, const char *fmt, ...) {
+	char tmp[1024];
+	va_list ap, again;
+	va_start(ap, fmt);
+	va_copy(again, ap);
+	int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+	va_end(ap);
+	if (n > 0 && (size_t)n < sizeof(tmp)) {
+		buf_append(b, tmp, (size_t)n);
+	} else if (n > 0) {
+		/* Too long for the stack buffer: format again into one that fits */
+		char *big = (char*)malloc((size_t)n + 1);
+		if (big) {
+			vsnprintf(big, (size_t)n + 1, fmt, again);
+			buf_append(b, big, (size_t)n);
+			free(big);
+		}
+	}
+	va_end(again);
+}
+
+static char *read_file(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (!f) return NULL;
+	Buffer b = {0};
+	char chunk[4096];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) buf_append(&b, chunk, n);
+	fclose(f);
+	return b.data;
+}
+
+static void sleep_ms(long ms) {
+	if (ms <= 0) return;
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+static double rand_unit(unsigned int *seed) {
+	return (double)rand_r(seed) / (double)RAND_MAX;
+}
+
+/* Days since 1970-01-01 for a civil date (proleptic Gregorian) */
+static long days_from_civil(int y, int m, int d) {
+	y -= m <= 2;
+	long era = (y >= 0 ? y : y - 399) / 400;
+	long yoe = y - era * 400;
+	long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(long z, int *y, int *m, int *d) {
+	z += 719468;
+	long era = (z >= 0 ? z : z - 146096) / 146097;
+	long doe = z - era * 146097;
+	long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	long mp = (5 * doy + 2) / 153;
+	*d = (int)(doy - (153 * mp + 2) / 5 + 1);
+	*m = (int)(mp < 10 ? mp + 3 : mp - 9);
+	*y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+static int query_param(const char *query, const char *name, char *out, size_t outsz) {
+	size_t name_len = strlen(name);
+	const char *p = query;
+	while (p && *p) {
+		if (strncmp(p, name, name_len) == 0 && p[name_len] == '=') {
+			const char *v = p + name_len + 1;
+			size_t n = strcspn(v, "& ");
+			if (n >= outsz) n = outsz - 1;
+			memcpy(out, v, n);
+			out[n] = '\0';
+			return 1;
+		}
+		p = strchr(p, '&');
+		if (p) p++;
+	}
+	return 0;
+}
+
+static void append_padding(Buffer *body) {
+	if (config.pad_bytes <= 0) return;
+	buf_append(body, ",\"info\":\"", 9);
+	for (int i = 0; i < config.pad_bytes; ++i) buf_append(body, "x", 1);
+	buf_append(body, "\"", 1);
+}
+
+static void build_weather(Buffer *body) {
+	if (recorded_weather) {
+		buf_append(body, recorded_weather, strlen(recorded_weather));
+		return;
+	}
+	pthread_mutex_lock(&stats_lock);
+	const char *main_value = config.weather_mains[weather_rotation++ % (unsigned long)config.weather_main_count];
+	pthread_mutex_unlock(&stats_lock);
+	buf_appendf(body,
+		"{\"coord\":{\"lon\":-97.74,\"lat\":30.27},\"weather\":[{\"id\":800,\"main\":\"%s\",\"description\":\"mock %s\",\"icon\":\"01d\"}],"
+		"\"base\":\"stations\",\"main\":{\"temp\":295.1,\"feels_like\":294.8,\"pressure\":1015,\"humidity\":48},"
+		"\"wind\":{\"speed\":3.6,\"deg\":160},\"name\":\"Mock City\",\"cod\":200", main_value, main_value);
+	append_padding(body);
+	buf_append(body, "}", 1);
+}
+
+/* Synthetic events: events_per_day on every UTC day of [startDateTime,
+ * endDateTime], paged by size/page exactly like the Discovery API. Venues sit
+ * at UTC-5, so localDate and the UTC dateTime agree only during the day. */
+static void build_events(const char *query, Buffer *body) {
+	if (recorded_events) {
+		buf_append(body, recorded_events, strlen(recorded_events));
+		return;
+	}
+	char start[32] = "", end[32] = "", size_s[16] = "", page_s[16] = "";
+	query_param(query, "startDateTime", start, sizeof(start));
+	query_param(query, "endDateTime", end, sizeof(end));
+	int size = query_param(query, "size", size_s, sizeof(size_s)) ? atoi(size_s) : 20;
+	int page = query_param(query, "page", page_s, sizeof(page_s)) ? atoi(page_s) : 0;
+	if (size <= 0) size = 20;
+	int sy = 2026, sm = 1, sd = 1, ey, em, ed;
+	sscanf(start, "%d-%d-%d", &sy, &sm, &sd);
+	if (sscanf(end, "%d-%d-%d", &ey, &em, &ed) != 3) { ey = sy; em = sm; ed = sd; }
+	long first = days_from_civil(sy, sm, sd);
+	long last = days_from_civil(ey, em, ed);
+	if (last < first) last = first;
+	long total = (last - first + 1) * config.events_per_day;
+	long total_pages = (total + size - 1) / size;
+
+	buf_append(body, "{", 1);
+	long begin = (long)page * size;
+	if (begin < total) {
+		buf_append(body, "\"_embedded\":{\"events\":[", 23);
+		for (long i = begin; i < total && i < begin + size; ++i) {
+			int y, m, d;
+			civil_from_days(first + i / config.events_per_day, &y, &m, &d);
+			buf_appendf(body,
+				"%s{\"name\":\"Mock Event %ld\",\"type\":\"event\",\"id\":\"MOCK%08ld\","
+				"\"dates\":{\"start\":{\"localDate\":\"%04d-%02d-%02d\",\"localTime\":\"14:30:00\",\"dateTime\":\"%04d-%02d-%02dT19:30:00Z\"},\"status\":{\"code\":\"onsale\"}},"
+				"\"_embedded\":{\"venues\":[{\"name\":\"Mock Venue %ld\",\"city\":{\"name\":\"Mock City\"}}]}",
+				i > begin ? "," : "", i, i, y, m, d, y, m, d, i % 17);
+			append_padding(body);
+			buf_append(body, "}", 1);
+		}
+		buf_append(body, "]},", 3);
+	}
+	buf_appendf(body, "\"page\":{\"size\":%d,\"totalElements\":%ld,\"totalPages\":%ld,\"number\":%d}}", size, total, total_pages, page);
+}
+
+static void build_stats(Buffer *body, int reset) {
+	pthread_mutex_lock(&stats_lock);
+	buf_appendf(body, "{\"requests\":%lu,\"weather\":%lu,\"events\":%lu,\"errors\":%lu,\"bytes_out\":%lu}",
+		stats.requests, stats.weather, stats.events, stats.errors, stats.bytes_out);
+	if (reset) memset(&stats, 0, sizeof(stats));
+	pthread_mutex_unlock(&stats_lock);
+}
+
+static int send_all(int fd, const char *data, size_t len) {
+	while (len > 0) {
+		/* SIGPIPE is ignored in main, so a closed peer shows up as an error here */
+		ssize_t n = send(fd, data, len, 0);
+		if (n <= 0) return 0;
+		data += n;
+		len -= (size_t)n;
+	}
+	return 1;
+}
+
+static int respond(int fd, int status, const char *reason, const Buffer *body, int close_after) {
+	size_t body_len = body->data ? body->size : 0;
+	Buffer out = {0};
+	buf_appendf(&out, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n%s\r\n",
+		status, reason, body_len, close_after ? "Connection: close\r\n" : "");
+	if (body_len > 0) buf_append(&out, body->data, body_len);
+	/* Single write so head and body never straddle a delayed ACK */
+	int ok = out.data && send_all(fd, out.data, out.size);
+	if (ok) {
+		pthread_mutex_lock(&stats_lock);
+		stats.bytes_out += (unsigned long)out.size;
+		pthread_mutex_unlock(&stats_lock);
+	}
+	free(out.data);
+	return ok;
+}
+
+static int handle_request(int fd, const char *target, int close_after, unsigned int *seed) {
+	const char *q = strchr(target, '?');
+	size_t path_len = q ? (size_t)(q - target) : strlen(target);
+	const char *query = q ? q + 1 : "";
+	Buffer body = {0};
+	int ok;
+
+	if (strncmp(target, "/__stats", path_len) == 0 && path_len == 8) {
+		build_stats(&body, strstr(query, "reset=1") != NULL);
+		ok = respond(fd, 200, "OK", &body, close_after);
+		free(body.data);
+		return ok;
+	}
+	int is_weather = path_len == 17 && strncmp(target, "/data/2.5/weather", 17) == 0;
+	int is_events = path_len == 25 && strncmp(target, "/discovery/v2/events.json", 25) == 0;
+
+	long delay = config.latency_ms;
+	if (config.jitter_ms > 0) delay += (long)(rand_unit(seed) * (double)config.jitter_ms);
+	sleep_ms(delay);
+
+	pthread_mutex_lock(&stats_lock);
+	stats.requests++;
+	if (is_weather) stats.weather++;
+	if (is_events) stats.events++;
+	pthread_mutex_unlock(&stats_lock);
+
+	if ((is_weather || is_events) && config.error_rate > 0.0 && rand_unit(seed) < config.error_rate) {
+		pthread_mutex_lock(&stats_lock);
+		stats.errors++;
+		pthread_mutex_unlock(&stats_lock);
+		buf_appendf(&body, "{\"error\":\"injected\"}");
+		ok = respond(fd, 503, "Service Unavailable", &body, close_after);
+	} else if (is_weather) {
+		build_weather(&body);
+		ok = respond(fd, 200, "OK", &body, close_after);
+	} else if (is_events) {
+		build_events(query, &body);
+		ok = respond(fd, 200, "OK", &body, close_after);
+	} else {
+		buf_appendf(&body, "{\"error\":\"not found\"}");
+		ok = respond(fd, 404, "Not Found", &body, close_after);
+	}
+	free(body.data);
+	return ok;
+}
+
+/* One thread per connection keeps injected latency from serializing clients */
+static void *connection_thread(void *arg) {
+	int fd = (int)(long)arg;
+	unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)fd;
+	char buf[MAX_REQUEST + 1];
+	size_t len = 0;
+	for (;;) {
+		buf[len] = '\0';
+		char *head_end = strstr(buf, "\r\n\r\n");
+		if (!head_end) {
+			if (len >= MAX_REQUEST) break;
+			ssize_t n = recv(fd, buf + len, MAX_REQUEST - len, 0);
+			if (n <= 0) break;
+			len += (size_t)n;
+			continue;
+		}
+		char method[16], target[2048], version[16];
+		if (sscanf(buf, "%15s %2047s %15s", method, target, version) != 3) break;
+		int close_after = strcmp(version, "HTTP/1.1") != 0;
+		for (char *h = strstr(buf, "\r\n"); h && h < head_end; h = strstr(h + 2, "\r\n")) {
+			if (strncasecmp(h + 2, "connection: close", 17) == 0) close_after = 1;
+		}
+		if (!handle_request(fd, target, close_after, &seed) || close_after) break;
+		size_t used = (size_t)(head_end + 4 - buf);
+		memmove(buf, buf + used, len - used);
+		len -= used;
+	}
+	close(fd);
+	return NULL;
+}
+
+static void print_usage(const char *prog) {
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --port P            listen port (default 9000)\n"
+		"  --latency-ms N      base response delay (default 0)\n"
+		"  --jitter-ms N       extra uniform random delay up to N ms (default 0)\n"
+		"  --error-rate F      fraction of upstream calls answered with 503 (default 0)\n"
+		"  --events-per-day N  synthetic events per day in a window (default 3)\n"
+		"  --pad-bytes N       filler bytes added to every payload object (default 0)\n"
+		"  --weather-main LIST weather \"main\" values served in rotation, comma-separated\n"
+		"                      (default Clear), e.g. Clear,Rain,Snow,Clouds\n"
+		"  --weather-file F    serve a recorded OpenWeather payload instead\n"
+		"  --events-file F     serve a recorded Ticketmaster payload instead\n"
+		"Endpoints: /data/2.5/weather, /discovery/v2/events.json, /__stats[?reset=1]\n",
+		prog);
+}
+
+int main(int argc, char **argv) {
+	config.port = 9000;
+	config.events_per_day = 3;
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (!val) { print_usage(argv[0]); return 2; }
+		if (strcmp(arg, "--port") == 0) config.port = atoi(val);
+		else if (strcmp(arg, "--latency-ms") == 0) config.latency_ms = atol(val);
+		else if (strcmp(arg, "--jitter-ms") == 0) config.jitter_ms = atol(val);
+		else if (strcmp(arg, "--error-rate") == 0) config.error_rate = atof(val);
+		else if (strcmp(arg, "--events-per-day") == 0) config.events_per_day = atoi(val);
+		else if (strcmp(arg, "--pad-bytes") == 0) config.pad_bytes = atoi(val);
+		else if (strcmp(arg, "--weather-main") == 0) {
+			config.weather_main_count = 0;
+			char *list = strdup(val);
+			char *save = NULL;
+			for (char *tok = list ? strtok_r(list, ",", &save) : NULL; tok && config.weather_main_count < MAX_WEATHER_MAINS; tok = strtok_r(NULL, ",", &save)) {
+				config.weather_mains[config.weather_main_count++] = tok;
+			}
+		}
+		else if (strcmp(arg, "--weather-file") == 0) config.weather_file = val;
+		else if (strcmp(arg, "--events-file") == 0) config.events_file = val;
+		else { print_usage(argv[0]); return 2; }
+		i++;
+	}
+	if (config.events_per_day < 1) config.events_per_day = 1;
+	if (config.weather_main_count == 0) config.weather_mains[config.weather_main_count++] = "Clear";
+	if (config.weather_file && !(recorded_weather = read_file(config.weather_file))) {
+		fprintf(stderr, "Cannot read %s\n", config.weather_file);
+		return 1;
+	}
+	if (config.events_file && !(recorded_events = read_file(config.events_file))) {
+		fprintf(stderr, "Cannot read %s\n", config.events_file);
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons((unsigned short)config.port);
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 128) != 0) {
+		perror("bind/listen");
+		return 1;
+	}
+	printf("mockUpstream listening on http://127.0.0.1:%d\n", config.port);
+	fflush(stdout);
+	for (;;) {
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR) continue;
+			perror("accept");
+			break;
+		}
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		pthread_t t;
+		if (pthread_create(&t, NULL, connection_thread, (void *)(long)fd) != 0) {
+			close(fd);
+			continue;
+		}
+		pthread_detach(t);
+	}
+	close(listen_fd);
+	return 0;
+}